@@ -5,222 +5,2208 @@
  * providing functionality to sort names and count entries.
  * It demonstrates the use of function pointers and callback functions
  * for flexible sorting operations critical in agricultural data management.
+ *
+ * Sorting is a stable O(n log n) merge sort over (name prefix, index) keys,
+ * so most comparisons are one integer compare; records are moved once at
+ * the end, or not at all when a sorted view is enough. A batch mode (--sort-file) sorts roster
+ * files of any size: in parallel when they fit in memory, otherwise as an
+ * external merge sort over sorted run files.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #define MAX_STUDENTS 100
 #define MAX_NAME_LENGTH 100
 #define MAX_DEPARTMENT_LENGTH 50
+#define INSERTION_SORT_THRESHOLD 16
+#define MAX_SORT_THREADS 64
+#define MAX_MERGE_FANIN 256
+#define DEFAULT_SORT_MEMORY_MB 1024
+#define ROSTER_IO_BUFFER (1 << 20)     // read/write buffer of the batch roster files
+#define RUN_IO_BUFFER (64 << 10)       // read buffer per run file while merging
+#define BUBBLE_BENCH_LIMIT 20000
+#define DEPARTMENT_TABLE_SLOTS 16   // initial hash slots (power of two)
+#define INDEX_MAX_LEVEL 16          // skip list levels, enough for 4^16 students
+#define NAME_INLINE_LENGTH 11       // longest name kept inside the Student record
+#define NAME_ARENA_PER_STUDENT 32   // batch memory budget for name bytes per student
+
+// Student name: names up to NAME_INLINE_LENGTH bytes are stored in the
+// handle itself (NUL-padded), longer ones in the name arena
+typedef struct {
+    uint32_t length;
+    union {
+        char inlined[NAME_INLINE_LENGTH + 1];
+        uint32_t offset;                        // into nameArena when not inlined
+    };
+} NameHandle;
 
 // Enhanced student structure for agricultural technology focus
 typedef struct {
-    char name[MAX_NAME_LENGTH];
-    char department[MAX_DEPARTMENT_LENGTH]; // Agricultural department
+    NameHandle name;
+    int department;     // Agricultural department, an ID in departmentTable
 } Student;
 
+// Sort key: the first 12 name bytes packed big-endian, so comparing them
+// as integers orders them like strcmp, plus the record's position. The
+// 4 bytes after the prefix fill what would otherwise be padding.
+typedef struct {
+    uint64_t prefix;    // name bytes 0-7
+    uint32_t tail;      // name bytes 8-11
+    int index;
+} SortKey;
+
+// What key comparisons need besides the keys themselves
+typedef struct {
+    const Student *students;                            // records the keys index
+    int (*compare)(const Student*, const Student*);     // callback order only
+} KeyContext;
+
+typedef int (*StudentCompare)(const Student*, const Student*);
+
+// Growable block of NUL-terminated strings, addressed by offset
+typedef struct {
+    char *bytes;
+    size_t used;
+    size_t capacity;
+} StringArena;
+
+// A department with its running student count
+typedef struct {
+    char name[MAX_DEPARTMENT_LENGTH];
+    int length;
+    uint32_t hash;
+    int students;
+} Department;
+
+// Dictionary of interned departments. Departments get small integer IDs in
+// order of first appearance; an open-addressing hash maps names to IDs.
+typedef struct {
+    Department *departments;    // indexed by ID
+    int count;
+    int capacity;
+    int *slots;                 // ID + 1 per slot, 0 when empty
+    int slotCount;              // power of two, at least twice 'count'
+    int students;               // students counted across all departments
+} DepartmentTable;
+
+// Departments of all students, kept up to date by addNewStudent
+DepartmentTable departmentTable;
+
+// Storage for the student names too long to inline
+StringArena nameArena;
+
+// Skip list node: one student in the ordered index
+typedef struct IndexNode {
+    int student;                // position in the students array
+    struct IndexNode *prev;     // level-0 back link, for backward iteration
+    struct IndexNode *next[];   // one forward link per level of the node
+} IndexNode;
+
+// Ordered index over a students array: a skip list keyed by 'compare',
+// with O(log n) insert and remove and in-order iteration both ways
+typedef struct {
+    IndexNode *head;            // sentinel with INDEX_MAX_LEVEL links
+    IndexNode *tail;            // last node, NULL when empty
+    int level;                  // levels in use
+    int count;
+    uint32_t random;            // xorshift state for node levels
+    int (*compare)(const Student*, const Student*);
+} StudentIndex;
+
+// Name order of the interactive roster, kept up to date as students are
+// added and removed
+StudentIndex studentIndex;
+
 // Function prototypes
 void sortNames(Student students[], int count, int (*compare)(const Student*, const Student*));
+int sortStudents(Student students[], int count, int (*compare)(const Student*, const Student*));
+SortKey *sortedView(const Student students[], int count, int (*compare)(const Student*, const Student*));
+void permuteStudents(Student students[], SortKey keys[], int count);
+void bubbleSortStudents(Student students[], int count, int (*compare)(const Student*, const Student*));
+int parallelSortKeys(SortKey keys[], int count, const Student students[], int threads, int descending);
+int parallelSortStudents(Student students[], int count, int threads, int descending);
+int sortRosterFile(const char *input, const char *output, int descending, int threads,
+                   size_t memoryBytes, const char *tmpDir);
+int runSortBenchmark(int count, int threads);
+int internDepartment(DepartmentTable *table, const char *name, size_t length);
+int storeName(NameHandle *handle, const char *name, size_t length);
+int reserveNameArena(size_t bytes);
+void freeNameArena();
+int setStudent(Student *student, const char *name, size_t nameLength, const char *department,
+               size_t departmentLength);
+void countStudent(DepartmentTable *table, const Student *student);
+void uncountStudent(DepartmentTable *table, const Student *student);
+void freeDepartmentTable(DepartmentTable *table);
+void printDepartmentStats(FILE *file, const DepartmentTable *table);
+int initStudentIndex(StudentIndex *index, int (*compare)(const Student*, const Student*));
+int indexInsert(StudentIndex *index, const Student students[], int student);
+int indexRemove(StudentIndex *index, const Student students[], const char *name);
+void indexMoveStudent(StudentIndex *index, const Student students[], int from, int to);
+void displayIndex(const StudentIndex *index, const Student students[], int descending);
+void freeStudentIndex(StudentIndex *index);
 int countNames(Student students[]);
 int ascendingCompare(const Student* a, const Student* b);
 int descendingCompare(const Student* a, const Student* b);
-void displayNames(Student students[], int count);
+void displayView(const Student students[], const SortKey keys[], int count);
 void clearInputBuffer();
 void addNewStudent(Student students[], int *count);
+void removeStudent(Student students[], int *count);
+
+// Array of function pointers (the count is passed by pointer so adding a
+// student can update it)
+typedef void (*FunctionPtr)(Student students[], int *count);
+
+/*
+ * Stable merge sort, instantiated once per element type and comparison.
+ * COMPARE(a, b) follows the callback convention (<0, 0, >0) and may use
+ * 'context'. The built-in orders get copies with the comparison inlined,
+ * so they pay no indirect call per comparison.
+ */
+#define DEFINE_MERGE_SORT(suffix, Type, Context, COMPARE)                                    \
+static void mergeRuns##suffix(const Type *left, int leftCount, const Type *right,            \
+                              int rightCount, Type *out, Context context) {                  \
+    int i = 0, j = 0, k = 0;                                                                 \
+    (void)context;                                                                           \
+    /* Ties take the left run first, which keeps the sort stable */                          \
+    while (i < leftCount && j < rightCount) {                                                \
+        if (COMPARE(&right[j], &left[i]) < 0) {                                              \
+            out[k++] = right[j++];                                                           \
+        } else {                                                                             \
+            out[k++] = left[i++];                                                            \
+        }                                                                                    \
+    }                                                                                        \
+    while (i < leftCount) {                                                                  \
+        out[k++] = left[i++];                                                                \
+    }                                                                                        \
+    while (j < rightCount) {                                                                 \
+        out[k++] = right[j++];                                                               \
+    }                                                                                        \
+}                                                                                            \
+                                                                                             \
+static void mergeSort##suffix(Type *items, Type *scratch, int count, Context context) {      \
+    (void)context;                                                                           \
+    if (count <= INSERTION_SORT_THRESHOLD) {                                                 \
+        for (int i = 1; i < count; i++) {                                                    \
+            Type key = items[i];                                                             \
+            int j = i - 1;                                                                   \
+            while (j >= 0 && COMPARE(&items[j], &key) > 0) {                                 \
+                items[j + 1] = items[j];                                                     \
+                j--;                                                                         \
+            }                                                                                \
+            items[j + 1] = key;                                                              \
+        }                                                                                    \
+        return;                                                                              \
+    }                                                                                        \
+    int half = count / 2;                                                                    \
+    mergeSort##suffix(items, scratch, half, context);                                        \
+    mergeSort##suffix(items + half, scratch, count - half, context);                         \
+    if (COMPARE(&items[half - 1], &items[half]) <= 0) {                                      \
+        return; /* halves already in order */                                                \
+    }                                                                                        \
+    /* Only the left half needs a copy: the merge never overtakes the right run */           \
+    memcpy(scratch, items, half * sizeof(Type));                                             \
+    mergeRuns##suffix(scratch, half, items + half, count - half, items, context);            \
+}
+
+/**
+ * Function to get a student's name
+ * 
+ * @param student Pointer to Student
+ * @return The NUL-terminated name, in the record or the name arena
+ */
+static inline const char *studentName(const Student *student) {
+    return student->name.length <= NAME_INLINE_LENGTH ? student->name.inlined
+                                                       : nameArena.bytes + student->name.offset;
+}
+
+/**
+ * Function to get a student's department name
+ * 
+ * @param student Pointer to Student
+ * @return The department name from departmentTable
+ */
+static inline const char *studentDepartment(const Student *student) {
+    return departmentTable.departments[student->department].name;
+}
+
+/**
+ * Function to pack the first 'width' bytes of a name into a big-endian
+ * integer (zero-padded), so integer order matches strcmp order
+ * 
+ * @param name Student name
+ * @param width Number of bytes to pack (at most 8)
+ * @return Packed bytes
+ */
+static inline uint64_t packNameBytes(const char *name, int width) {
+    uint64_t packed = 0;
+    int i = 0;
+    
+    for (; i < width && name[i] != '\0'; i++) {
+        packed = packed << 8 | (unsigned char)name[i];
+    }
+    for (; i < width; i++) {
+        packed <<= 8;
+    }
+    return packed;
+}
+
+/**
+ * Function to compare the names behind two sort keys. Most pairs differ in
+ * the packed bytes; only equal keys of names longer than 11 bytes, which
+ * live in the name arena, reach strcmp.
+ * 
+ * @param a First key
+ * @param b Second key
+ * @param students Records the keys index
+ * @return Comparison result, as strcmp on the names
+ */
+static inline int compareKeyNames(const SortKey *a, const SortKey *b, const Student *students) {
+    if (a->prefix != b->prefix) {
+        return a->prefix < b->prefix ? -1 : 1;
+    }
+    if (a->tail != b->tail) {
+        return a->tail < b->tail ? -1 : 1;
+    }
+    // A zero last byte means both names ended inside the (equal) packed bytes
+    if ((a->tail & 0xff) == 0) {
+        return 0;
+    }
+    return strcmp(studentName(&students[a->index]) + 12, studentName(&students[b->index]) + 12);
+}
+
+#define CALLBACK_COMPARE(a, b) context((a), (b))
+#define KEY_ASCENDING_COMPARE(a, b) compareKeyNames((a), (b), context->students)
+#define KEY_DESCENDING_COMPARE(a, b) compareKeyNames((b), (a), context->students)
+#define KEY_CALLBACK_COMPARE(a, b) context->compare(&context->students[(a)->index], \
+                                                    &context->students[(b)->index])
+
+DEFINE_MERGE_SORT(Callback, Student, StudentCompare, CALLBACK_COMPARE)
+DEFINE_MERGE_SORT(KeysAscending, SortKey, const KeyContext *, KEY_ASCENDING_COMPARE)
+DEFINE_MERGE_SORT(KeysDescending, SortKey, const KeyContext *, KEY_DESCENDING_COMPARE)
+DEFINE_MERGE_SORT(KeysCallback, SortKey, const KeyContext *, KEY_CALLBACK_COMPARE)
+
+/**
+ * Function to sort students with a stable merge sort, without displaying them.
+ * The sort runs over (name prefix, index) keys; each record is then moved
+ * once, into its final place.
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param compare Function pointer to comparison function
+ * @return 0 on success, -1 if the keys could not be allocated
+ */
+int sortStudents(Student students[], int count, int (*compare)(const Student*, const Student*)) {
+    if (count < 2) {
+        return 0;
+    }
+    SortKey *keys = sortedView(students, count, compare);
+    if (keys == NULL) {
+        return -1;
+    }
+    
+    permuteStudents(students, keys, count);
+    free(keys);
+    return 0;
+}
+
+/**
+ * Function to build one sort key per student
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param keys Array of 'count' keys to fill
+ */
+void buildSortKeys(const Student students[], int count, SortKey keys[]) {
+    for (int i = 0; i < count; i++) {
+        const char *name = studentName(&students[i]);
+        keys[i].prefix = packNameBytes(name, 8);
+        keys[i].tail = students[i].name.length > 8 ? (uint32_t)packNameBytes(name + 8, 4) : 0;
+        keys[i].index = i;
+    }
+}
+
+/**
+ * Function to get a sorted view of the students without moving them: the
+ * returned keys list record indices in sorted order (stable). The built-in
+ * comparison functions are recognised and compare key prefixes inline;
+ * any other callback is called on the records the keys point to.
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param compare Function pointer to comparison function
+ * @return Sorted keys (free with free()), or NULL if memory ran out
+ */
+SortKey *sortedView(const Student students[], int count, int (*compare)(const Student*, const Student*)) {
+    SortKey *keys = malloc((size_t)(count > 0 ? count : 1) * sizeof(SortKey));
+    SortKey *scratch = malloc((size_t)(count / 2 + 1) * sizeof(SortKey));
+    if (keys == NULL || scratch == NULL) {
+        free(keys);
+        free(scratch);
+        return NULL;
+    }
+    KeyContext context = {students, compare};
+    
+    buildSortKeys(students, count, keys);
+    if (compare == ascendingCompare) {
+        mergeSortKeysAscending(keys, scratch, count, &context);
+    } else if (compare == descendingCompare) {
+        mergeSortKeysDescending(keys, scratch, count, &context);
+    } else {
+        mergeSortKeysCallback(keys, scratch, count, &context);
+    }
+    
+    free(scratch);
+    return keys;
+}
+
+/**
+ * Function to move the students into the order of sorted keys, in place.
+ * Every record is copied once, following the cycles of the permutation;
+ * the keys' indices are consumed.
+ * 
+ * @param students Array of Student structures
+ * @param keys Sorted keys for the array
+ * @param count Number of students in the array
+ */
+void permuteStudents(Student students[], SortKey keys[], int count) {
+    for (int i = 0; i < count; i++) {
+        if (keys[i].index == i) {
+            continue;
+        }
+        Student temp = students[i];
+        int j = i;
+        // Position j receives the record the key at j names; done keys point at themselves
+        while (keys[j].index != i) {
+            int from = keys[j].index;
+            students[j] = students[from];
+            keys[j].index = j;
+            j = from;
+        }
+        students[j] = temp;
+        keys[j].index = j;
+    }
+}
+
+/**
+ * Function to sort students with the original bubble sort (kept as the
+ * baseline for --bench)
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param compare Function pointer to comparison function
+ */
+void bubbleSortStudents(Student students[], int count, int (*compare)(const Student*, const Student*)) {
+    Student temp;
+    
+    for (int i = 0; i < count - 1; i++) {
+        for (int j = 0; j < count - i - 1; j++) {
+            if (compare(&students[j], &students[j + 1]) > 0) {
+                // Swap students
+                temp = students[j];
+                students[j] = students[j + 1];
+                students[j + 1] = temp;
+            }
+        }
+    }
+}
+
+/**
+ * Function to display student names in the order of a comparison function.
+ * This demonstrates the use of function pointers for flexible sorting algorithms.
+ * The built-in orders on the interactive roster are a walk over its index;
+ * any other order is shown through a sorted view, so the records (and the
+ * positions the index refers to) are not moved.
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param compare Function pointer to comparison function
+ */
+void sortNames(Student students[], int count, int (*compare)(const Student*, const Student*)) {
+    if (studentIndex.head != NULL && studentIndex.count == count && studentIndex.compare == ascendingCompare &&
+        (compare == ascendingCompare || compare == descendingCompare)) {
+        printf("\n===== Sorted Agricultural Technology Students =====\n");
+        displayIndex(&studentIndex, students, compare == descendingCompare);
+        return;
+    }
+    
+    SortKey *keys = sortedView(students, count, compare);
+    if (keys == NULL) {
+        printf("Error: Not enough memory to sort %d students.\n", count);
+        return;
+    }
+    printf("\n===== Sorted Agricultural Technology Students =====\n");
+    displayView(students, keys, count);
+    free(keys);
+}
+
+/**
+ * Function to hash a department name (FNV-1a)
+ * 
+ * @param name Department name
+ * @return 32-bit hash
+ */
+static uint32_t hashDepartment(const char *name) {
+    uint32_t hash = 2166136261u;
+    
+    for (; *name != '\0'; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Function to rebuild the hash slots of a department table with a new size
+ * 
+ * @param table Department table
+ * @param slotCount New number of slots (power of two)
+ * @return 0 on success, -1 if memory ran out (the table is unchanged)
+ */
+static int resizeDepartmentSlots(DepartmentTable *table, int slotCount) {
+    int *slots = calloc((size_t)slotCount, sizeof(int));
+    if (slots == NULL) {
+        return -1;
+    }
+    
+    for (int id = 0; id < table->count; id++) {
+        int slot = table->departments[id].hash & (slotCount - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = id + 1;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slotCount = slotCount;
+    return 0;
+}
+
+/**
+ * Function to look up a department's ID, adding the department if it is new
+ * 
+ * @param table Department table
+ * @param name Department name (need not be NUL-terminated)
+ * @param length Length of the name (truncated to MAX_DEPARTMENT_LENGTH - 1 bytes)
+ * @return Department ID, or -1 if memory ran out
+ */
+int internDepartment(DepartmentTable *table, const char *name, size_t length) {
+    char key[MAX_DEPARTMENT_LENGTH];
+    if (length >= sizeof(key)) {
+        length = sizeof(key) - 1;
+    }
+    memcpy(key, name, length);
+    key[length] = '\0';
+    uint32_t hash = hashDepartment(key);
+    
+    if (table->slots != NULL) {
+        int slot = hash & (table->slotCount - 1);
+        while (table->slots[slot] != 0) {
+            const Department *department = &table->departments[table->slots[slot] - 1];
+            if (department->hash == hash && strcmp(department->name, key) == 0) {
+                return table->slots[slot] - 1;
+            }
+            slot = (slot + 1) & (table->slotCount - 1);
+        }
+    }
+    
+    // New department: keep the slots at most half full
+    if (table->slots == NULL || 2 * (table->count + 1) > table->slotCount) {
+        int slotCount = table->slots == NULL ? DEPARTMENT_TABLE_SLOTS : 2 * table->slotCount;
+        if (resizeDepartmentSlots(table, slotCount) != 0) {
+            return -1;
+        }
+    }
+    if (table->count == table->capacity) {
+        int capacity = table->capacity == 0 ? DEPARTMENT_TABLE_SLOTS / 2 : 2 * table->capacity;
+        Department *departments = realloc(table->departments, (size_t)capacity * sizeof(Department));
+        if (departments == NULL) {
+            return -1;
+        }
+        table->departments = departments;
+        table->capacity = capacity;
+    }
+    
+    int id = table->count++;
+    strcpy(table->departments[id].name, key);
+    table->departments[id].length = (int)strlen(key);
+    table->departments[id].hash = hash;
+    table->departments[id].students = 0;
+    
+    int slot = hash & (table->slotCount - 1);
+    while (table->slots[slot] != 0) {
+        slot = (slot + 1) & (table->slotCount - 1);
+    }
+    table->slots[slot] = id + 1;
+    return id;
+}
+
+/**
+ * Function to add a student to the running department counts
+ * 
+ * @param table Department table the student's department ID belongs to
+ * @param student Student to count
+ */
+void countStudent(DepartmentTable *table, const Student *student) {
+    table->departments[student->department].students++;
+    table->students++;
+}
+
+/**
+ * Function to take a student out of the running department counts
+ * 
+ * @param table Department table the student's department ID belongs to
+ * @param student Student counted earlier with countStudent
+ */
+void uncountStudent(DepartmentTable *table, const Student *student) {
+    if (table->departments[student->department].students > 0) {
+        table->departments[student->department].students--;
+        table->students--;
+    }
+}
+
+/**
+ * Function to store a student name: short names inline in the handle,
+ * longer ones appended to the name arena
+ * 
+ * @param handle Handle to fill in
+ * @param name Name bytes (need not be NUL-terminated)
+ * @param length Length of the name (truncated to MAX_NAME_LENGTH - 1 bytes)
+ * @return 0 on success, -1 if the arena could not grow
+ */
+int storeName(NameHandle *handle, const char *name, size_t length) {
+    const char *nul = memchr(name, '\0', length);
+    if (nul != NULL) {
+        length = (size_t)(nul - name);
+    }
+    if (length >= MAX_NAME_LENGTH) {
+        length = MAX_NAME_LENGTH - 1;
+    }
+    
+    // Zero the padding too, so equal records compare equal byte for byte
+    memset(handle, 0, sizeof(*handle));
+    handle->length = (uint32_t)length;
+    if (length <= NAME_INLINE_LENGTH) {
+        memcpy(handle->inlined, name, length);
+        return 0;
+    }
+    
+    if (nameArena.used + length + 1 > nameArena.capacity) {
+        size_t capacity = nameArena.capacity > 0 ? 2 * nameArena.capacity : 4096;
+        if (capacity > UINT32_MAX) {
+            capacity = UINT32_MAX;
+        }
+        if (nameArena.used + length + 1 > capacity || reserveNameArena(capacity) != 0) {
+            return -1;
+        }
+    }
+    handle->offset = (uint32_t)nameArena.used;
+    memcpy(nameArena.bytes + nameArena.used, name, length);
+    nameArena.bytes[nameArena.used + length] = '\0';
+    nameArena.used += length + 1;
+    return 0;
+}
+
+/**
+ * Function to make room for at least 'bytes' bytes in the name arena
+ * 
+ * @param bytes Capacity wanted (offsets are 32-bit, so at most 4 GB)
+ * @return 0 on success, -1 if the arena could not grow
+ */
+int reserveNameArena(size_t bytes) {
+    if (bytes <= nameArena.capacity) {
+        return 0;
+    }
+    if (bytes > UINT32_MAX) {
+        return -1;
+    }
+    char *grown = realloc(nameArena.bytes, bytes);
+    if (grown == NULL) {
+        return -1;
+    }
+    nameArena.bytes = grown;
+    nameArena.capacity = bytes;
+    return 0;
+}
+
+/**
+ * Function to release the name arena
+ */
+void freeNameArena() {
+    free(nameArena.bytes);
+    memset(&nameArena, 0, sizeof(nameArena));
+}
+
+/**
+ * Function to fill in a student: the name goes to the arena (or inline) and
+ * the department is interned in departmentTable
+ * 
+ * @param student Student to fill in
+ * @param name Name bytes (need not be NUL-terminated)
+ * @param nameLength Length of the name
+ * @param department Department name (need not be NUL-terminated)
+ * @param departmentLength Length of the department name
+ * @return 0 on success, -1 if memory ran out
+ */
+int setStudent(Student *student, const char *name, size_t nameLength, const char *department,
+               size_t departmentLength) {
+    student->department = internDepartment(&departmentTable, department, departmentLength);
+    if (student->department < 0 || storeName(&student->name, name, nameLength) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Function to release a department table
+ * 
+ * @param table Department table
+ */
+void freeDepartmentTable(DepartmentTable *table) {
+    free(table->departments);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+/**
+ * Function to print the number of students and the department statistics
+ * of a department table
+ * 
+ * @param file Where to print
+ * @param table Department table
+ */
+void printDepartmentStats(FILE *file, const DepartmentTable *table) {
+    fprintf(file, "\nTotal number of agricultural technology students: %d\n", table->students);
+    
+    // Display department statistics
+    fprintf(file, "\n===== Department Distribution =====\n");
+    
+    // Departments appear in the order they were first seen
+    for (int id = 0; id < table->count; id++) {
+        fprintf(file, "%s: %d students\n", table->departments[id].name, table->departments[id].students);
+    }
+}
+
+/**
+ * Function to display the number of students and the department statistics.
+ * The counts are kept up to date by addNewStudent, so this costs
+ * O(departments) and does not rescan the array.
+ * 
+ * @param students Array of Student structures
+ * @return Number of students in the array
+ */
+int countNames(Student students[]) {
+    (void)students;
+    
+    printDepartmentStats(stdout, &departmentTable);
+    return departmentTable.students;
+}
+
+/**
+ * Function to set up an empty ordered index
+ * 
+ * @param index Index to initialise
+ * @param compare Function pointer to the comparison that orders the index
+ * @return 0 on success, -1 if memory ran out
+ */
+int initStudentIndex(StudentIndex *index, int (*compare)(const Student*, const Student*)) {
+    memset(index, 0, sizeof(*index));
+    index->head = calloc(1, sizeof(IndexNode) + INDEX_MAX_LEVEL * sizeof(IndexNode *));
+    if (index->head == NULL) {
+        return -1;
+    }
+    index->level = 1;
+    index->random = 2463534242u;
+    index->compare = compare;
+    return 0;
+}
+
+/**
+ * Function to pick the level of a new skip list node: each extra level
+ * has probability 1/4
+ * 
+ * @param index Ordered index (its random state advances)
+ * @return Level between 1 and INDEX_MAX_LEVEL
+ */
+static int randomIndexLevel(StudentIndex *index) {
+    uint32_t x = index->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    index->random = x;
+    
+    int level = 1;
+    while (level < INDEX_MAX_LEVEL && (x & 3) == 0) {
+        level++;
+        x >>= 2;
+    }
+    return level;
+}
+
+/**
+ * Function to insert a student into the ordered index. Students with equal
+ * names stay in insertion order.
+ * 
+ * @param index Ordered index
+ * @param students Array of Student structures
+ * @param student Position of the new student in the array
+ * @return 0 on success, -1 if memory ran out
+ */
+int indexInsert(StudentIndex *index, const Student students[], int student) {
+    IndexNode *update[INDEX_MAX_LEVEL];
+    IndexNode *node = index->head;
+    
+    // Find the last node at each level that sorts before or with the new one
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (node->next[i] != NULL &&
+               index->compare(&students[node->next[i]->student], &students[student]) <= 0) {
+            node = node->next[i];
+        }
+        update[i] = node;
+    }
+    
+    int level = randomIndexLevel(index);
+    IndexNode *inserted = malloc(sizeof(IndexNode) + (size_t)level * sizeof(IndexNode *));
+    if (inserted == NULL) {
+        return -1;
+    }
+    for (int i = index->level; i < level; i++) {
+        update[i] = index->head;
+    }
+    if (level > index->level) {
+        index->level = level;
+    }
+    
+    inserted->student = student;
+    for (int i = 0; i < level; i++) {
+        inserted->next[i] = update[i]->next[i];
+        update[i]->next[i] = inserted;
+    }
+    inserted->prev = update[0] == index->head ? NULL : update[0];
+    if (inserted->next[0] != NULL) {
+        inserted->next[0]->prev = inserted;
+    } else {
+        index->tail = inserted;
+    }
+    index->count++;
+    return 0;
+}
+
+/**
+ * Function to find, at every level, the last node that sorts before a key
+ * 
+ * @param index Ordered index
+ * @param students Array of Student structures
+ * @param key Record with the name to look for
+ * @param update Receives one node per level in use
+ * @return First node with the key's name, or NULL if there is none
+ */
+static IndexNode *findIndexName(const StudentIndex *index, const Student students[], const Student *key,
+                                IndexNode *update[]) {
+    IndexNode *node = index->head;
+    
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (node->next[i] != NULL && index->compare(&students[node->next[i]->student], key) < 0) {
+            node = node->next[i];
+        }
+        update[i] = node;
+    }
+    node = node->next[0];
+    if (node == NULL || index->compare(&students[node->student], key) != 0) {
+        return NULL;
+    }
+    return node;
+}
+
+/**
+ * Function to remove the first (earliest added) student with a name from
+ * the ordered index
+ * 
+ * @param index Ordered index
+ * @param students Array of Student structures
+ * @param name Name of the student to remove (not pointing into the name arena)
+ * @return Array position of the removed student, or -1 if the name is not indexed
+ */
+int indexRemove(StudentIndex *index, const Student students[], const char *name) {
+    IndexNode *update[INDEX_MAX_LEVEL];
+    // The key is a temporary record; its arena bytes are released straight away
+    Student key = {0};
+    size_t mark = nameArena.used;
+    if (storeName(&key.name, name, strlen(name)) != 0) {
+        return -1;
+    }
+    IndexNode *node = findIndexName(index, students, &key, update);
+    nameArena.used = mark;
+    if (node == NULL) {
+        return -1;
+    }
+    
+    for (int i = 0; i < index->level && update[i]->next[i] == node; i++) {
+        update[i]->next[i] = node->next[i];
+    }
+    if (node->next[0] != NULL) {
+        node->next[0]->prev = node->prev;
+    } else {
+        index->tail = node->prev;
+    }
+    while (index->level > 1 && index->head->next[index->level - 1] == NULL) {
+        index->level--;
+    }
+    
+    int student = node->student;
+    free(node);
+    index->count--;
+    return student;
+}
+
+/**
+ * Function to update the index after a student's record moved to another
+ * position in the array
+ * 
+ * @param index Ordered index
+ * @param students Array of Student structures (the record is already at 'to')
+ * @param from Old position of the record
+ * @param to New position of the record
+ */
+void indexMoveStudent(StudentIndex *index, const Student students[], int from, int to) {
+    IndexNode *update[INDEX_MAX_LEVEL];
+    IndexNode *node = findIndexName(index, students, &students[to], update);
+    
+    // Equal names are adjacent; find the one that pointed at the old slot
+    while (node != NULL && node->student != from) {
+        node = node->next[0];
+    }
+    if (node != NULL) {
+        node->student = to;
+    }
+}
+
+/**
+ * Function to display student names and departments in index order.
+ * Descending order walks the index backwards; students with equal names
+ * still appear in the order they were added.
+ * 
+ * @param index Ordered index
+ * @param students Array of Student structures
+ * @param descending Nonzero to display in reverse order
+ */
+void displayIndex(const StudentIndex *index, const Student students[], int descending) {
+    int row = 1;
+    
+    printf("%-5s %-30s %-20s\n", "ID", "Name", "Department");
+    printf("%-5s %-30s %-20s\n", "--", "----", "----------");
+    
+    if (!descending) {
+        for (const IndexNode *node = index->head->next[0]; node != NULL; node = node->next[0]) {
+            printf("%-5d %-30s %-20s\n", row++, studentName(&students[node->student]),
+                   studentDepartment(&students[node->student]));
+        }
+        return;
+    }
+    
+    const IndexNode *last = index->tail;
+    while (last != NULL) {
+        // Back up to the first of a group of equal names, then print the group forwards
+        const IndexNode *first = last;
+        while (first->prev != NULL &&
+               index->compare(&students[first->prev->student], &students[last->student]) == 0) {
+            first = first->prev;
+        }
+        for (const IndexNode *node = first; node != last->next[0]; node = node->next[0]) {
+            printf("%-5d %-30s %-20s\n", row++, studentName(&students[node->student]),
+                   studentDepartment(&students[node->student]));
+        }
+        last = first->prev;
+    }
+}
+
+/**
+ * Function to release an ordered index
+ * 
+ * @param index Ordered index
+ */
+void freeStudentIndex(StudentIndex *index) {
+    IndexNode *node = index->head;
+    
+    while (node != NULL) {
+        IndexNode *next = node->next[0];
+        free(node);
+        node = next;
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+/**
+ * Comparison function for ascending order
+ * 
+ * @param a Pointer to first Student
+ * @param b Pointer to second Student
+ * @return Comparison result
+ */
+int ascendingCompare(const Student* a, const Student* b) {
+    return strcmp(studentName(a), studentName(b));
+}
+
+/**
+ * Comparison function for descending order
+ * 
+ * @param a Pointer to first Student
+ * @param b Pointer to second Student
+ * @return Comparison result
+ */
+int descendingCompare(const Student* a, const Student* b) {
+    return strcmp(studentName(b), studentName(a));
+}
+
+/**
+ * Function to display student names and departments in the order of a
+ * sorted view
+ * 
+ * @param students Array of Student structures
+ * @param keys Sorted keys for the array
+ * @param count Number of students in the array
+ */
+void displayView(const Student students[], const SortKey keys[], int count) {
+    printf("%-5s %-30s %-20s\n", "ID", "Name", "Department");
+    printf("%-5s %-30s %-20s\n", "--", "----", "----------");
+    
+    for (int i = 0; i < count; i++) {
+        const Student *student = &students[keys[i].index];
+        printf("%-5d %-30s %-20s\n", i + 1, studentName(student), studentDepartment(student));
+    }
+}
+
+/**
+ * Function to clear input buffer
+ */
+void clearInputBuffer() {
+    int c;
+    while ((c = getchar()) != '\n' && c != EOF);
+}
+
+/**
+ * Function to add a new student to the array
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the current count of students
+ */
+void addNewStudent(Student students[], int *count) {
+    if (*count >= MAX_STUDENTS) {
+        printf("Error: Maximum number of students reached.\n");
+        return;
+    }
+    
+    char name[MAX_NAME_LENGTH] = "";
+    char department[MAX_DEPARTMENT_LENGTH] = "";
+    
+    printf("\n===== Add New Agricultural Technology Student =====\n");
+    
+    printf("Enter student name: ");
+    fgets(name, MAX_NAME_LENGTH, stdin);
+    name[strcspn(name, "\n")] = '\0';
+    
+    printf("Enter department (Crop Science/Soil Science/IoT Systems/Data Analytics/Field Operations): ");
+    fgets(department, MAX_DEPARTMENT_LENGTH, stdin);
+    department[strcspn(department, "\n")] = '\0';
+    
+    if (setStudent(&students[*count], name, strlen(name), department, strlen(department)) != 0 ||
+        indexInsert(&studentIndex, students, *count) != 0) {
+        printf("Error: Not enough memory to add the student.\n");
+        return;
+    }
+    countStudent(&departmentTable, &students[*count]);
+    (*count)++;
+    printf("Student added successfully.\n");
+}
+
+/**
+ * Function to remove a student, by name, from the array. The last student
+ * moves into the freed slot, so the array stays dense.
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the current count of students
+ */
+void removeStudent(Student students[], int *count) {
+    char name[MAX_NAME_LENGTH];
+    
+    printf("\n===== Remove Agricultural Technology Student =====\n");
+    
+    printf("Enter student name: ");
+    if (fgets(name, sizeof(name), stdin) == NULL) {
+        return;
+    }
+    name[strcspn(name, "\n")] = '\0';
+    
+    int position = indexRemove(&studentIndex, students, name);
+    if (position < 0) {
+        printf("Error: No student named '%s'.\n", name);
+        return;
+    }
+    uncountStudent(&departmentTable, &students[position]);
+    
+    int last = *count - 1;
+    if (position != last) {
+        students[position] = students[last];
+        indexMoveStudent(&studentIndex, students, last, position);
+    }
+    memset(&students[last], 0, sizeof(Student));
+    (*count)--;
+    printf("Student removed successfully.\n");
+}
+
+/**
+ * Function to sort names (for function pointer array)
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the number of students in the array
+ */
+void sortNamesWrapper(Student students[], int *count) {
+    char order[5];
+    printf("Enter sorting order ('asc' for ascending, 'desc' for descending): ");
+    scanf("%4s", order);
+    clearInputBuffer();
+    
+    if (strcmp(order, "asc") == 0) {
+        sortNames(students, *count, ascendingCompare);
+    } else if (strcmp(order, "desc") == 0) {
+        sortNames(students, *count, descendingCompare);
+    } else {
+        printf("Invalid sorting order. Please enter 'asc' or 'desc'.\n");
+    }
+}
+
+/**
+ * Function to count names (for function pointer array)
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the number of students in the array
+ */
+void countNamesWrapper(Student students[], int *count) {
+    (void)count;
+    countNames(students);
+}
+
+/**
+ * Function to add student (for function pointer array)
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the current count of students
+ */
+void addStudentWrapper(Student students[], int *count) {
+    addNewStudent(students, count);
+}
+
+/**
+ * Function to remove student (for function pointer array)
+ * 
+ * @param students Array of Student structures
+ * @param count Pointer to the current count of students
+ */
+void removeStudentWrapper(Student students[], int *count) {
+    removeStudent(students, count);
+}
+
+/**
+ * Function to read the monotonic clock in seconds
+ * 
+ * @return Seconds since an arbitrary fixed point
+ */
+double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// One piece of a parallel sort: sort a range, or merge two sorted ranges
+typedef struct {
+    SortKey *keys;          // range to sort, or the output of a merge
+    SortKey *scratch;
+    int count;
+    const SortKey *left;    // runs to merge (NULL when sorting)
+    int leftCount;
+    const SortKey *right;
+    int rightCount;
+    const KeyContext *context;
+    int descending;
+} SortTask;
+
+/**
+ * Thread body for one SortTask
+ * 
+ * @param arg Pointer to the SortTask
+ * @return NULL
+ */
+void *runSortTask(void *arg) {
+    SortTask *task = (SortTask *)arg;
+    if (task->left == NULL) {
+        if (task->descending) {
+            mergeSortKeysDescending(task->keys, task->scratch, task->count, task->context);
+        } else {
+            mergeSortKeysAscending(task->keys, task->scratch, task->count, task->context);
+        }
+    } else if (task->descending) {
+        mergeRunsKeysDescending(task->left, task->leftCount, task->right, task->rightCount, task->keys,
+                                task->context);
+    } else {
+        mergeRunsKeysAscending(task->left, task->leftCount, task->right, task->rightCount, task->keys,
+                               task->context);
+    }
+    return NULL;
+}
+
+/**
+ * Function to run SortTasks on their own threads and wait for all of them
+ * 
+ * @param tasks Array of tasks
+ * @param count Number of tasks
+ */
+void runSortTasks(SortTask tasks[], int count) {
+    pthread_t threads[2 * MAX_SORT_THREADS];
+    int started[2 * MAX_SORT_THREADS];
+    
+    for (int t = 0; t < count; t++) {
+        // A task whose thread cannot be started runs on this one
+        started[t] = pthread_create(&threads[t], NULL, runSortTask, &tasks[t]) == 0;
+        if (!started[t]) {
+            runSortTask(&tasks[t]);
+        }
+    }
+    for (int t = 0; t < count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+}
+
+/**
+ * Function to find how many elements of 'left' are among the first 'diagonal'
+ * outputs of a stable merge of 'left' and 'right' (the merge-path split)
+ * 
+ * @param left First sorted run
+ * @param leftCount Length of the first run
+ * @param right Second sorted run
+ * @param rightCount Length of the second run
+ * @param diagonal Number of merged outputs
+ * @param students Records the keys index
+ * @param descending Non-zero for descending order
+ * @return Elements taken from 'left'
+ */
+int mergeSplit(const SortKey *left, int leftCount, const SortKey *right, int rightCount, long diagonal,
+               const Student *students, int descending) {
+    int low = diagonal > rightCount ? (int)(diagonal - rightCount) : 0;
+    int high = diagonal < leftCount ? (int)diagonal : leftCount;
+    
+    while (low < high) {
+        int i = low + (high - low) / 2;
+        int j = (int)(diagonal - i);
+        // Ties go to 'left', so left[i] precedes right[j - 1] when it is not greater
+        int order = descending ? compareKeyNames(&right[j - 1], &left[i], students)
+                               : compareKeyNames(&left[i], &right[j - 1], students);
+        if (order <= 0) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+/**
+ * Function to sort the keys of students by name on several threads: each
+ * thread sorts a slice, then slices are merged pairwise, every merge split
+ * across threads. The records themselves are not moved.
+ * 
+ * @param keys Keys built by buildSortKeys
+ * @param count Number of keys
+ * @param students Records the keys index
+ * @param threads Number of threads to use
+ * @param descending Non-zero for descending order
+ * @return 0 on success, -1 if the scratch buffer could not be allocated
+ */
+int parallelSortKeys(SortKey keys[], int count, const Student students[], int threads, int descending) {
+    if (threads > MAX_SORT_THREADS) {
+        threads = MAX_SORT_THREADS;
+    }
+    if (threads > count / INSERTION_SORT_THRESHOLD) {
+        threads = count / INSERTION_SORT_THRESHOLD > 0 ? count / INSERTION_SORT_THRESHOLD : 1;
+    }
+    SortKey *scratch = malloc((size_t)(count > 0 ? count : 1) * sizeof(SortKey));
+    if (scratch == NULL) {
+        return -1;
+    }
+    KeyContext context = {students, NULL};
+    
+    // Slice boundaries: slice s is [bounds[s], bounds[s + 1])
+    int bounds[MAX_SORT_THREADS + 1];
+    SortTask tasks[2 * MAX_SORT_THREADS];
+    for (int s = 0; s <= threads; s++) {
+        bounds[s] = (int)((long)count * s / threads);
+    }
+    for (int s = 0; s < threads; s++) {
+        SortTask task = {keys + bounds[s], scratch + bounds[s], bounds[s + 1] - bounds[s],
+                         NULL, 0, NULL, 0, &context, descending};
+        tasks[s] = task;
+    }
+    runSortTasks(tasks, threads);
+    
+    // Merge rounds ping-pong between the two buffers
+    SortKey *from = keys, *to = scratch;
+    int runs = threads;
+    while (runs > 1) {
+        int pairs = runs / 2;
+        int pieces = threads / pairs > 0 ? threads / pairs : 1;
+        int numTasks = 0;
+        
+        for (int p = 0; p < pairs; p++) {
+            const SortKey *left = from + bounds[2 * p];
+            const SortKey *right = from + bounds[2 * p + 1];
+            int leftCount = bounds[2 * p + 1] - bounds[2 * p];
+            int rightCount = bounds[2 * p + 2] - bounds[2 * p + 1];
+            long total = (long)leftCount + rightCount;
+            
+            for (int k = 0; k < pieces; k++) {
+                long begin = total * k / pieces, end = total * (k + 1) / pieces;
+                int i0 = mergeSplit(left, leftCount, right, rightCount, begin, students, descending);
+                int i1 = mergeSplit(left, leftCount, right, rightCount, end, students, descending);
+                SortTask task = {to + bounds[2 * p] + begin, NULL, 0, left + i0, i1 - i0,
+                                 right + (begin - i0), (int)(end - i1) - (int)(begin - i0),
+                                 &context, descending};
+                tasks[numTasks++] = task;
+            }
+        }
+        runSortTasks(tasks, numTasks);
+        
+        // An odd run out carries over unchanged
+        if (runs % 2 == 1) {
+            memcpy(to + bounds[runs - 1], from + bounds[runs - 1],
+                   (size_t)(bounds[runs] - bounds[runs - 1]) * sizeof(SortKey));
+        }
+        for (int r = 0; r <= pairs; r++) {
+            bounds[r] = bounds[r * 2 <= runs ? r * 2 : runs];
+        }
+        bounds[pairs + runs % 2] = count;
+        runs = pairs + runs % 2;
+        
+        SortKey *swap = from;
+        from = to;
+        to = swap;
+    }
+    
+    if (from != keys) {
+        memcpy(keys, from, (size_t)count * sizeof(SortKey));
+    }
+    free(scratch);
+    return 0;
+}
+
+/**
+ * Function to sort students by name on several threads, moving each record
+ * once after the keys are sorted
+ * 
+ * @param students Array of Student structures
+ * @param count Number of students in the array
+ * @param threads Number of threads to use
+ * @param descending Non-zero for descending order
+ * @return 0 on success, -1 if memory ran out
+ */
+int parallelSortStudents(Student students[], int count, int threads, int descending) {
+    SortKey *keys = malloc((size_t)(count > 0 ? count : 1) * sizeof(SortKey));
+    if (keys == NULL) {
+        return -1;
+    }
+    
+    buildSortKeys(students, count, keys);
+    int status = parallelSortKeys(keys, count, students, threads, descending);
+    if (status == 0) {
+        permuteStudents(students, keys, count);
+    }
+    free(keys);
+    return status;
+}
+
+// Buffered roster input; lines are handed out in place, without copying
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t size;
+    size_t start;       // unread bytes are buffer[start, end)
+    size_t end;
+    int eof;
+    int skipping;       // dropping the rest of an over-long line
+} RosterReader;
 
-// Array of function pointers
-typedef void (*FunctionPtr)(Student students[], int count);
+// Buffered roster output, written in large blocks
+typedef struct {
+    int fd;
+    char *buffer;
+    size_t size;
+    size_t used;
+    int error;
+} RosterWriter;
 
 /**
- * Function to sort student names using callback function for comparison
- * This demonstrates the use of function pointers for flexible sorting algorithms
+ * Function to open a roster file for buffered reading
  * 
- * @param students Array of Student structures
- * @param count Number of students in the array
- * @param compare Function pointer to comparison function
+ * @param reader Reader to set up
+ * @param path File to read ("-" for stdin)
+ * @param size Buffer size in bytes
+ * @return 0 on success, -1 on failure (errno is set)
  */
-void sortNames(Student students[], int count, int (*compare)(const Student*, const Student*)) {
-    Student temp;
-    
-    // Bubble sort implementation with callback function
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (compare(&students[j], &students[j + 1]) > 0) {
-                // Swap students
-                temp = students[j];
-                students[j] = students[j + 1];
-                students[j + 1] = temp;
+int openRosterReader(RosterReader *reader, const char *path, size_t size) {
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+    if (reader->fd < 0) {
+        return -1;
+    }
+    reader->buffer = malloc(size);
+    if (reader->buffer == NULL) {
+        if (reader->fd != STDIN_FILENO) close(reader->fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    reader->size = size;
+    return 0;
+}
+
+/**
+ * Function to close a roster reader
+ * 
+ * @param reader Reader opened with openRosterReader
+ */
+void closeRosterReader(RosterReader *reader) {
+    if (reader->fd != STDIN_FILENO) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+    reader->buffer = NULL;
+}
+
+/**
+ * Function to get the next line of a roster. The line points into the
+ * reader's buffer and stays valid until the next call. A line longer than
+ * the buffer is cut at the buffer size.
+ * 
+ * @param reader Roster reader
+ * @param line Receives the start of the line
+ * @param length Receives the length of the line, without its newline
+ * @return 1 for a line, 0 at end of input, -1 on a read error
+ */
+int nextRosterLine(RosterReader *reader, const char **line, size_t *length) {
+    for (;;) {
+        char *begin = reader->buffer + reader->start;
+        size_t available = reader->end - reader->start;
+        char *newline = memchr(begin, '\n', available);
+        
+        if (newline != NULL) {
+            reader->start += (size_t)(newline - begin) + 1;
+            if (reader->skipping) {
+                reader->skipping = 0;
+                continue;
+            }
+            *line = begin;
+            *length = (size_t)(newline - begin);
+            return 1;
+        }
+        
+        // A last line without a newline, or a line that fills the whole buffer
+        if (reader->eof || available == reader->size) {
+            if (available == 0) {
+                return 0;
             }
+            int skipped = reader->skipping;
+            reader->skipping = !reader->eof;
+            reader->start = reader->end;
+            if (skipped) {
+                continue;
+            }
+            *line = begin;
+            *length = available;
+            return 1;
+        }
+        
+        // Move the partial line to the front and refill behind it
+        memmove(reader->buffer, begin, available);
+        reader->start = 0;
+        reader->end = available;
+        ssize_t got = read(reader->fd, reader->buffer + reader->end, reader->size - reader->end);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
         }
+        if (got == 0) {
+            reader->eof = 1;
+        }
+        reader->end += (size_t)got;
     }
-    
-    // Display the sorted names
-    printf("\n===== Sorted Agricultural Technology Students =====\n");
-    displayNames(students, count);
 }
 
 /**
- * Function to count the number of students in the array
+ * Function to give a roster writer its buffer once its file is open
  * 
- * @param students Array of Student structures
- * @return Number of students in the array
+ * @param writer Writer whose fd was just opened (-1 if that failed)
+ * @param size Buffer size in bytes
+ * @return 0 on success, -1 on failure (errno is set)
  */
-int countNames(Student students[]) {
-    int count = 0;
-    
-    while (count < MAX_STUDENTS && students[count].name[0] != '\0') {
-        count++;
+static int attachRosterWriter(RosterWriter *writer, size_t size) {
+    if (writer->fd < 0) {
+        return -1;
     }
+    writer->buffer = malloc(size);
+    if (writer->buffer == NULL) {
+        if (writer->fd != STDOUT_FILENO) close(writer->fd);
+        errno = ENOMEM;
+        return -1;
+    }
+    writer->size = size;
+    return 0;
+}
+
+/**
+ * Function to open a roster file for buffered writing
+ * 
+ * @param writer Writer to set up
+ * @param path File to write ("-" for stdout)
+ * @param size Buffer size in bytes (larger than one record)
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+int openRosterWriter(RosterWriter *writer, const char *path, size_t size) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = strcmp(path, "-") == 0 ? STDOUT_FILENO : open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return attachRosterWriter(writer, size);
+}
+
+/**
+ * Function to create a run file for buffered writing. Run files hold
+ * roster data, so only the owner may read them, and an existing file
+ * (or a link planted in its place) is never opened.
+ * 
+ * @param writer Writer to set up
+ * @param path Run file to create
+ * @param size Buffer size in bytes (larger than one record)
+ * @return 0 on success, -1 on failure (errno is set)
+ */
+static int openRunWriter(RosterWriter *writer, const char *path, size_t size) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    return attachRosterWriter(writer, size);
+}
+
+/**
+ * Function to write out everything buffered in a roster writer
+ * 
+ * @param writer Roster writer
+ */
+static void flushRosterWriter(RosterWriter *writer) {
+    size_t done = 0;
     
-    printf("\nTotal number of agricultural technology students: %d\n", count);
-    
-    // Display department statistics
-    printf("\n===== Department Distribution =====\n");
-    
-    // Define key agricultural technology departments
-    const char *agDepts[] = {"Crop Science", "Soil Science", "IoT Systems", "Data Analytics", "Field Operations"};
-    const int numDepts = 5;
-    int deptCounts[5] = {0};
-    
-    // Count students in each department
-    for (int i = 0; i < count; i++) {
-        for (int j = 0; j < numDepts; j++) {
-            if (strstr(students[i].department, agDepts[j]) != NULL) {
-                deptCounts[j]++;
-                break;
-            }
+    while (done < writer->used && !writer->error) {
+        ssize_t written = write(writer->fd, writer->buffer + done, writer->used - done);
+        if (written < 0 && errno != EINTR) {
+            writer->error = 1;
+        } else if (written > 0) {
+            done += (size_t)written;
         }
     }
-    
-    // Display department counts
-    for (int i = 0; i < numDepts; i++) {
-        printf("%s: %d students\n", agDepts[i], deptCounts[i]);
+    writer->used = 0;
+}
+
+/**
+ * Function to flush and close a roster writer
+ * 
+ * @param writer Writer opened with openRosterWriter
+ * @return 0 on success, -1 if any write failed
+ */
+int closeRosterWriter(RosterWriter *writer) {
+    flushRosterWriter(writer);
+    if (writer->fd != STDOUT_FILENO && close(writer->fd) != 0) {
+        writer->error = 1;
+    }
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return writer->error ? -1 : 0;
+}
+
+// Fields of one roster line, pointing into the line
+typedef struct {
+    const char *name;
+    size_t nameLength;
+    const char *department;
+    size_t departmentLength;
+} RosterFields;
+
+/**
+ * Function to split one roster line ("name,department") into its fields,
+ * without copying. Fields longer than MAX_NAME_LENGTH - 1 and
+ * MAX_DEPARTMENT_LENGTH - 1 bytes are truncated.
+ * 
+ * @param line Line of text (not NUL-terminated)
+ * @param length Length of the line, without its newline
+ * @param fields Receives the fields
+ * @return 1 if the line held a record, 0 for a blank line
+ */
+int parseRosterLine(const char *line, size_t length, RosterFields *fields) {
+    const char *cr = memchr(line, '\r', length);
+    if (cr != NULL) {
+        length = (size_t)(cr - line);
     }
+    if (length == 0) {
+        return 0;
+    }
+    const char *comma = memchr(line, ',', length);
+    size_t nameLength = comma != NULL ? (size_t)(comma - line) : length;
+    size_t deptLength = comma != NULL ? length - nameLength - 1 : 0;
     
-    return count;
+    if (nameLength >= MAX_NAME_LENGTH) {
+        nameLength = MAX_NAME_LENGTH - 1;
+    }
+    if (deptLength >= MAX_DEPARTMENT_LENGTH) {
+        deptLength = MAX_DEPARTMENT_LENGTH - 1;
+    }
+    fields->name = line;
+    fields->nameLength = nameLength;
+    fields->department = comma != NULL ? comma + 1 : "";
+    fields->departmentLength = deptLength;
+    return 1;
 }
 
 /**
- * Comparison function for ascending order
+ * Function to read roster records until the array is full or the name
+ * arena holds 'nameBytes' bytes
  * 
- * @param a Pointer to first Student
- * @param b Pointer to second Student
- * @return Comparison result
+ * @param reader Roster reader
+ * @param students Array to fill
+ * @param capacity Size of the array
+ * @param nameBytes Name arena budget for the chunk
+ * @return Number of records read, or -1 on a read error or when memory ran out
  */
-int ascendingCompare(const Student* a, const Student* b) {
-    return strcmp(a->name, b->name);
+int readRosterChunk(RosterReader *reader, Student students[], int capacity, size_t nameBytes) {
+    const char *line;
+    size_t length;
+    RosterFields fields;
+    int count = 0, status = 0;
+    
+    while (count < capacity && nameArena.used < nameBytes &&
+           (status = nextRosterLine(reader, &line, &length)) == 1) {
+        if (parseRosterLine(line, length, &fields) == 0) {
+            continue;
+        }
+        if (setStudent(&students[count], fields.name, fields.nameLength, fields.department,
+                       fields.departmentLength) != 0) {
+            errno = ENOMEM;
+            return -1;
+        }
+        count++;
+    }
+    return status < 0 ? -1 : count;
 }
 
 /**
- * Comparison function for descending order
+ * Function to append one "name,department" line to a roster writer
  * 
- * @param a Pointer to first Student
- * @param b Pointer to second Student
- * @return Comparison result
+ * @param writer Roster writer
+ * @param name Name bytes
+ * @param nameLength Length of the name
+ * @param department Department bytes
+ * @param departmentLength Length of the department
  */
-int descendingCompare(const Student* a, const Student* b) {
-    return strcmp(b->name, a->name);
+static inline void writeRosterLine(RosterWriter *writer, const char *name, size_t nameLength,
+                                   const char *department, size_t departmentLength) {
+    if (writer->used + nameLength + departmentLength + 2 > writer->size) {
+        flushRosterWriter(writer);
+    }
+    char *out = writer->buffer + writer->used;
+    memcpy(out, name, nameLength);
+    out[nameLength] = ',';
+    memcpy(out + nameLength + 1, department, departmentLength);
+    out[nameLength + 1 + departmentLength] = '\n';
+    writer->used += nameLength + departmentLength + 2;
 }
 
 /**
- * Function to display student names and departments
+ * Function to write roster records as "name,department" lines, in the
+ * order of sorted keys
  * 
+ * @param writer Roster writer
  * @param students Array of Student structures
- * @param count Number of students in the array
+ * @param order Sorted keys for the array
+ * @param count Number of students to write
+ * @return 0 on success, -1 on a write error
  */
-void displayNames(Student students[], int count) {
-    printf("%-5s %-30s %-20s\n", "ID", "Name", "Department");
-    printf("%-5s %-30s %-20s\n", "--", "----", "----------");
+int writeRosterRecords(RosterWriter *writer, const Student students[], const SortKey order[], int count) {
+    for (int i = 0; i < count && !writer->error; i++) {
+        // Sorted keys point all over the records and the name arena; fetch ahead
+        if (i + 16 < count) {
+            __builtin_prefetch(&students[order[i + 16].index]);
+        }
+        if (i + 8 < count) {
+            __builtin_prefetch(studentName(&students[order[i + 8].index]));
+        }
+        const Student *student = &students[order[i].index];
+        const Department *department = &departmentTable.departments[student->department];
+        writeRosterLine(writer, studentName(student), student->name.length, department->name,
+                        (size_t)department->length);
+    }
+    return writer->error ? -1 : 0;
+}
+
+// Head of one sorted run during a k-way merge
+typedef struct {
+    char name[MAX_NAME_LENGTH];
+    char department[MAX_DEPARTMENT_LENGTH];
+    RosterReader reader;
+    int run;        // position of the run in input order; breaks ties
+} RunHead;
+
+/**
+ * Function to read the next record of a run file into its run head
+ * 
+ * @param head Run head
+ * @return 1 for a record, 0 at the end of the run, -1 on a read error
+ */
+static int readRunHead(RunHead *head) {
+    const char *line;
+    size_t length;
+    RosterFields fields;
+    int status;
     
-    for (int i = 0; i < count; i++) {
-        printf("%-5d %-30s %-20s\n", i + 1, students[i].name, students[i].department);
+    while ((status = nextRosterLine(&head->reader, &line, &length)) == 1) {
+        if (parseRosterLine(line, length, &fields) == 1) {
+            memcpy(head->name, fields.name, fields.nameLength);
+            head->name[fields.nameLength] = '\0';
+            memcpy(head->department, fields.department, fields.departmentLength);
+            head->department[fields.departmentLength] = '\0';
+            return 1;
+        }
     }
+    return status;
 }
 
 /**
- * Function to clear input buffer
+ * Function to tell whether run head 'a' must be output before 'b'
+ * 
+ * @param a First run head
+ * @param b Second run head
+ * @param descending Non-zero for descending order
+ * @return Non-zero when 'a' goes first
  */
-void clearInputBuffer() {
-    int c;
-    while ((c = getchar()) != '\n' && c != EOF);
+static int runHeadBefore(const RunHead *a, const RunHead *b, int descending) {
+    int result = descending ? strcmp(b->name, a->name) : strcmp(a->name, b->name);
+    return result < 0 || (result == 0 && a->run < b->run);
 }
 
 /**
- * Function to add a new student to the array
+ * Function to restore the min-heap property below position 'i'
  * 
- * @param students Array of Student structures
- * @param count Pointer to the current count of students
+ * @param heap Array of run heads
+ * @param size Number of heads in the heap
+ * @param i Position to sift down from
+ * @param descending Non-zero for descending order
  */
-void addNewStudent(Student students[], int *count) {
-    if (*count >= MAX_STUDENTS) {
-        printf("Error: Maximum number of students reached.\n");
-        return;
+void siftDownRunHeads(RunHead heap[], int size, int i, int descending) {
+    for (;;) {
+        int smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && runHeadBefore(&heap[l], &heap[smallest], descending)) smallest = l;
+        if (r < size && runHeadBefore(&heap[r], &heap[smallest], descending)) smallest = r;
+        if (smallest == i) {
+            return;
+        }
+        RunHead temp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = temp;
+        i = smallest;
+    }
+}
+
+/**
+ * Function to merge sorted run files into one sorted output, stably
+ * (equal names keep the order of the runs)
+ * 
+ * @param paths Run files, in input order
+ * @param count Number of run files
+ * @param output Roster writer for the merged output
+ * @param descending Non-zero for descending order
+ * @return 0 on success, -1 on an I/O error
+ */
+int mergeRunFiles(char *paths[], int count, RosterWriter *output, int descending) {
+    RunHead *heap = malloc((size_t)count * sizeof(RunHead));
+    int size = 0, status = 0;
+    if (heap == NULL) {
+        return -1;
     }
     
-    printf("\n===== Add New Agricultural Technology Student =====\n");
+    for (int r = 0; r < count; r++) {
+        if (openRosterReader(&heap[size].reader, paths[r], RUN_IO_BUFFER) != 0) {
+            perror("Error opening run file");
+            status = -1;
+            continue;
+        }
+        heap[size].run = r;
+        int read = readRunHead(&heap[size]);
+        if (read == 1) {
+            size++;
+        } else {
+            status = read < 0 ? -1 : status;
+            closeRosterReader(&heap[size].reader);
+        }
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) {
+        siftDownRunHeads(heap, size, i, descending);
+    }
     
-    printf("Enter student name: ");
-    fgets(students[*count].name, MAX_NAME_LENGTH, stdin);
-    students[*count].name[strcspn(students[*count].name, "\n")] = '\0';
+    while (size > 0 && status == 0) {
+        writeRosterLine(output, heap[0].name, strlen(heap[0].name), heap[0].department,
+                        strlen(heap[0].department));
+        status = output->error ? -1 : 0;
+        int read = readRunHead(&heap[0]);
+        if (read != 1) {
+            status = read < 0 ? -1 : status;
+            closeRosterReader(&heap[0].reader);
+            heap[0] = heap[--size];
+        }
+        siftDownRunHeads(heap, size, 0, descending);
+    }
+    for (int i = 0; i < size; i++) {
+        closeRosterReader(&heap[i].reader);
+    }
+    free(heap);
+    return status;
+}
+
+/**
+ * Function to sort a roster file of any size by name. Records are read in
+ * chunks that fit 'memoryBytes'; a roster that fits in one chunk is sorted
+ * in parallel and written out directly, otherwise every chunk becomes a
+ * sorted run file and the runs are merged (in several passes if there are
+ * more than MAX_MERGE_FANIN). The order matches ascendingCompare or
+ * descendingCompare, with equal names kept in input order. Input and
+ * output go through large buffers, and the department counts are taken
+ * in the same pass as the reading.
+ * 
+ * @param input Roster file to sort ("-" for stdin)
+ * @param output File to write the sorted roster to ("-" for stdout)
+ * @param descending Non-zero for descending order
+ * @param threads Number of sorting threads
+ * @param memoryBytes Memory budget for records in flight
+ * @param tmpDir Directory in which a private directory for the run files is made
+ * @return 0 on success, 1 on failure
+ */
+int sortRosterFile(const char *input, const char *output, int descending, int threads,
+                   size_t memoryBytes, const char *tmpDir) {
+    // Records, their names, the keys and the parallel sort's scratch keys must fit the budget
+    size_t capacity = memoryBytes / (sizeof(Student) + 2 * sizeof(SortKey) + NAME_ARENA_PER_STUDENT);
+    if (capacity < 1024) {
+        capacity = 1024;
+    }
+    if (capacity > (size_t)(INT_MAX / 2)) {
+        capacity = INT_MAX / 2;
+    }
+    size_t nameBytes = capacity * NAME_ARENA_PER_STUDENT;
+    if (nameBytes > UINT32_MAX - MAX_NAME_LENGTH) {
+        nameBytes = UINT32_MAX - MAX_NAME_LENGTH;
+    }
     
-    printf("Enter department (Crop Science/Soil Science/IoT Systems/Data Analytics/Field Operations): ");
-    fgets(students[*count].department, MAX_DEPARTMENT_LENGTH, stdin);
-    students[*count].department[strcspn(students[*count].department, "\n")] = '\0';
+    RosterReader in;
+    if (openRosterReader(&in, input, ROSTER_IO_BUFFER) != 0) {
+        perror("Error opening roster file");
+        return 1;
+    }
+    Student *students = malloc(capacity * sizeof(Student));
+    SortKey *keys = malloc(capacity * sizeof(SortKey));
+    // A chunk stops once the arena passes nameBytes, so one more name always fits
+    if (students == NULL || keys == NULL || reserveNameArena(nameBytes + MAX_NAME_LENGTH) != 0) {
+        fprintf(stderr, "Error: Not enough memory for %zu students.\n", capacity);
+        free(students);
+        free(keys);
+        closeRosterReader(&in);
+        return 1;
+    }
     
-    (*count)++;
-    printf("Student added successfully.\n");
+    double start = nowSeconds();
+    long long total = 0;
+    int numRuns = 0, runCapacity = 0, status = 0;
+    char **runs = NULL;
+    char *runDir = NULL;
+    RosterWriter out;
+    int count = 0;
+    while (status == 0) {
+        // Each chunk reuses the name arena from the start
+        nameArena.used = 0;
+        count = readRosterChunk(&in, students, (int)capacity, nameBytes);
+        if (count <= 0) {
+            break;
+        }
+        total += count;
+        for (int i = 0; i < count; i++) {
+            countStudent(&departmentTable, &students[i]);
+        }
+        
+        // Runs are written through the sorted keys; the records stay put
+        buildSortKeys(students, count, keys);
+        if (parallelSortKeys(keys, count, students, threads, descending) != 0) {
+            fprintf(stderr, "Error: Not enough memory to sort %d students.\n", count);
+            status = 1;
+            break;
+        }
+        
+        // A roster that fits in one chunk never touches the disk
+        if (numRuns == 0 && in.eof && in.start == in.end) {
+            if (openRosterWriter(&out, output, ROSTER_IO_BUFFER) != 0) {
+                perror("Error writing sorted roster");
+                status = 1;
+                break;
+            }
+            writeRosterRecords(&out, students, keys, count);
+            if (closeRosterWriter(&out) != 0) {
+                perror("Error writing sorted roster");
+                status = 1;
+            }
+            break;
+        }
+        
+        if (numRuns == runCapacity) {
+            runCapacity = runCapacity > 0 ? 2 * runCapacity : 16;
+            char **grown = realloc(runs, runCapacity * sizeof(char *));
+            if (grown == NULL) {
+                status = 1;
+                break;
+            }
+            runs = grown;
+        }
+        if (runDir == NULL) {
+            // Runs go in a fresh directory that only this user can enter
+            runDir = malloc(strlen(tmpDir) + 32);
+            if (runDir == NULL) {
+                status = 1;
+                break;
+            }
+            sprintf(runDir, "%s/roster-sort-XXXXXX", tmpDir);
+            if (mkdtemp(runDir) == NULL) {
+                perror("Error creating run directory");
+                free(runDir);
+                runDir = NULL;
+                status = 1;
+                break;
+            }
+        }
+        runs[numRuns] = malloc(strlen(runDir) + 16);
+        if (runs[numRuns] == NULL) {
+            status = 1;
+            break;
+        }
+        sprintf(runs[numRuns], "%s/run-%d", runDir, numRuns);
+        if (openRunWriter(&out, runs[numRuns++], ROSTER_IO_BUFFER) != 0) {
+            perror("Error writing run file");
+            status = 1;
+            break;
+        }
+        writeRosterRecords(&out, students, keys, count);
+        if (closeRosterWriter(&out) != 0) {
+            perror("Error writing run file");
+            status = 1;
+        }
+    }
+    if (count < 0) {
+        perror("Error reading roster file");
+        status = 1;
+    }
+    free(students);
+    free(keys);
+    closeRosterReader(&in);
+    
+    // An empty roster still produces an (empty) output file
+    if (status == 0 && total == 0) {
+        if (openRosterWriter(&out, output, ROSTER_IO_BUFFER) != 0 || closeRosterWriter(&out) != 0) {
+            perror("Error writing sorted roster");
+            status = 1;
+        }
+    }
+    
+    int runFiles = numRuns;
+    if (status == 0 && numRuns > 0) {
+        // Merge groups of runs until one pass can merge them all; each
+        // group's output takes the group's place, so run order is kept
+        int pass = 0;
+        while (status == 0 && numRuns > MAX_MERGE_FANIN) {
+            int merged = 0, first;
+            for (first = 0; first < numRuns && status == 0; first += MAX_MERGE_FANIN) {
+                int groupSize = numRuns - first < MAX_MERGE_FANIN ? numRuns - first : MAX_MERGE_FANIN;
+                char *path = malloc(strlen(runDir) + 32);
+                if (path == NULL) {
+                    status = 1;
+                } else {
+                    sprintf(path, "%s/pass-%d-%d", runDir, pass, merged);
+                    if (openRunWriter(&out, path, ROSTER_IO_BUFFER) != 0) {
+                        status = 1;
+                    } else {
+                        int result = mergeRunFiles(runs + first, groupSize, &out, descending);
+                        if (closeRosterWriter(&out) != 0 || result != 0) {
+                            status = 1;
+                        }
+                    }
+                }
+                for (int r = first; r < first + groupSize; r++) {
+                    unlink(runs[r]);
+                    free(runs[r]);
+                }
+                runs[merged++] = path;
+            }
+            // After a failure, the runs not merged yet are still removed below
+            while (first < numRuns) {
+                runs[merged++] = runs[first++];
+            }
+            numRuns = merged;
+            pass++;
+        }
+        
+        if (status == 0 && openRosterWriter(&out, output, ROSTER_IO_BUFFER) == 0) {
+            int result = mergeRunFiles(runs, numRuns, &out, descending);
+            if (closeRosterWriter(&out) != 0 || result != 0) {
+                status = 1;
+            }
+        } else {
+            status = 1;
+        }
+        if (status != 0) {
+            perror("Error merging sorted runs");
+        }
+    }
+    for (int r = 0; r < numRuns; r++) {
+        if (runs[r] != NULL) {
+            unlink(runs[r]);
+            free(runs[r]);
+        }
+    }
+    free(runs);
+    if (runDir != NULL) {
+        rmdir(runDir);
+        free(runDir);
+    }
+    
+    if (status == 0) {
+        fprintf(stderr, "Sorted %lld students %s in %.3f seconds (%d threads, %d run files)\n", total,
+                descending ? "descending" : "ascending", nowSeconds() - start, threads, runFiles);
+    }
+    return status;
 }
 
 /**
- * Function to sort names (for function pointer array)
+ * Function to fill an array with generated students for the benchmark.
+ * Names look like a real roster's: a common first name and a surname of
+ * two or three syllables, so names of 5 to 25 bytes vary early on and
+ * only some repeat in full.
  * 
- * @param students Array of Student structures
- * @param count Number of students in the array
+ * @param students Array to fill
+ * @param count Number of students to generate
+ * @param seed Seed of the generator
+ * @return 0 on success, -1 if memory ran out
  */
-void sortNamesWrapper(Student students[], int count) {
-    char order[5];
-    printf("Enter sorting order ('asc' for ascending, 'desc' for descending): ");
-    scanf("%4s", order);
-    clearInputBuffer();
+int generateStudents(Student students[], int count, unsigned int seed) {
+    static const char *first[] = {"Aisha", "Ana", "Ben", "Chen", "Chloe", "Daniel", "Diego", "Elena", "Emily",
+                                  "Fatima", "Grace", "Hana", "Ivan", "James", "Jennifer", "Jin", "Kofi",
+                                  "Laura", "Li", "Lucas", "Maria", "Mateo", "Michael", "Mohammed", "Nia",
+                                  "Noah", "Olga", "Omar", "Priya", "Rahul", "Sara", "Sofia", "Tariq",
+                                  "Thomas", "Wei", "Yara", "Yusuf", "Zoe"};
+    static const char *syllables[] = {"ba", "dor", "ga", "ken", "ko", "la", "mar", "mi", "na", "no", "pe",
+                                      "ra", "ri", "sa", "son", "ta", "tel", "to", "va", "ve", "win", "zi"};
+    static const char *depts[] = {"Crop Science", "Soil Science", "IoT Systems", "Data Analytics", "Field Operations"};
+    const unsigned int numFirst = sizeof(first) / sizeof(first[0]);
+    const unsigned int numSyllables = sizeof(syllables) / sizeof(syllables[0]);
     
-    if (strcmp(order, "asc") == 0) {
-        sortNames(students, count, ascendingCompare);
-    } else if (strcmp(order, "desc") == 0) {
-        sortNames(students, count, descendingCompare);
-    } else {
-        printf("Invalid sorting order. Please enter 'asc' or 'desc'.\n");
+    char name[MAX_NAME_LENGTH];
+    
+    for (int i = 0; i < count; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned int r = seed >> 4;
+        unsigned int a = r % numSyllables, b = r / numSyllables % numSyllables;
+        unsigned int c = r / numSyllables / numSyllables % (numSyllables + 1);
+        int length = snprintf(name, sizeof(name), "%s %c%s%s%s", first[(seed >> 20) % numFirst],
+                              toupper((unsigned char)syllables[a][0]), syllables[a] + 1, syllables[b],
+                              c < numSyllables ? syllables[c] : "");
+        if (setStudent(&students[i], name, (size_t)length, depts[i % 5], strlen(depts[i % 5])) != 0) {
+            return -1;
+        }
     }
+    return 0;
 }
 
 /**
- * Function to count names (for function pointer array)
+ * Function to time the sorting paths on 'count' generated students and check
+ * that they all produce the same order as the original bubble sort
  * 
- * @param students Array of Student structures
- * @param count Number of students in the array
+ * @param count Number of students to sort
+ * @param threads Threads for the parallel sort
+ * @return 0 if every path agreed, 1 otherwise
  */
-void countNamesWrapper(Student students[], int count) {
-    countNames(students);
+int runSortBenchmark(int count, int threads) {
+    Student *original = malloc((size_t)count * sizeof(Student));
+    Student *work = malloc((size_t)count * sizeof(Student));
+    Student *reference = malloc((size_t)count * sizeof(Student));
+    int status = 0;
+    if (original == NULL || work == NULL || reference == NULL) {
+        printf("Error: Not enough memory for %d students.\n", count);
+        free(original);
+        free(work);
+        free(reference);
+        return 1;
+    }
+    if (generateStudents(original, count, 42) != 0) {
+        printf("Error: Not enough memory for %d students.\n", count);
+        free(original);
+        free(work);
+        free(reference);
+        return 1;
+    }
+    
+    printf("===== Sort benchmark: %d students =====\n", count);
+    printf("Student record: %zu bytes, plus %.1f name arena bytes per student\n", sizeof(Student),
+           count > 0 ? (double)nameArena.used / count : 0.0);
+    printf("%-28s %-12s %-10s\n", "Method", "Seconds", "Matches");
+    for (int descending = 0; descending <= 1; descending++) {
+        int (*compare)(const Student*, const Student*) = descending ? descendingCompare : ascendingCompare;
+        const char *order = descending ? "desc" : "asc";
+        char label[64];
+        
+        // Reference order: the callback merge sort (stable, like the bubble sort)
+        memcpy(reference, original, (size_t)count * sizeof(Student));
+        double start = nowSeconds();
+        mergeSortCallback(reference, work, count, compare);
+        snprintf(label, sizeof(label), "merge sort, records (%s)", order);
+        printf("%-28s %-12.6f %-10s\n", label, nowSeconds() - start, "-");
+        
+        if (count <= BUBBLE_BENCH_LIMIT) {
+            memcpy(work, original, (size_t)count * sizeof(Student));
+            start = nowSeconds();
+            bubbleSortStudents(work, count, compare);
+            double seconds = nowSeconds() - start;
+            int same = memcmp(work, reference, (size_t)count * sizeof(Student)) == 0;
+            snprintf(label, sizeof(label), "bubble sort (%s)", order);
+            printf("%-28s %-12.6f %-10s\n", label, seconds, same ? "yes" : "NO");
+            status |= !same;
+        } else {
+            snprintf(label, sizeof(label), "bubble sort (%s)", order);
+            printf("%-28s %-12s %-10s\n", label, "skipped", "-");
+        }
+        
+        // The view leaves the records where they are; check the order it names
+        start = nowSeconds();
+        SortKey *keys = sortedView(original, count, compare);
+        double seconds = nowSeconds() - start;
+        int same = keys != NULL;
+        for (int i = 0; i < count && same; i++) {
+            same = memcmp(&original[keys[i].index], &reference[i], sizeof(Student)) == 0;
+        }
+        snprintf(label, sizeof(label), "key sort, view only (%s)", order);
+        printf("%-28s %-12.6f %-10s\n", label, seconds, same ? "yes" : "NO");
+        status |= !same;
+        free(keys);
+        
+        memcpy(work, original, (size_t)count * sizeof(Student));
+        start = nowSeconds();
+        int failed = sortStudents(work, count, compare);
+        seconds = nowSeconds() - start;
+        same = !failed && memcmp(work, reference, (size_t)count * sizeof(Student)) == 0;
+        snprintf(label, sizeof(label), "key sort + permute (%s)", order);
+        printf("%-28s %-12.6f %-10s\n", label, seconds, same ? "yes" : "NO");
+        status |= !same;
+        
+        memcpy(work, original, (size_t)count * sizeof(Student));
+        start = nowSeconds();
+        failed = parallelSortStudents(work, count, threads, descending);
+        seconds = nowSeconds() - start;
+        same = !failed && memcmp(work, reference, (size_t)count * sizeof(Student)) == 0;
+        snprintf(label, sizeof(label), "parallel, %d threads (%s)", threads, order);
+        printf("%-28s %-12.6f %-10s\n", label, seconds, same ? "yes" : "NO");
+        status |= !same;
+    }
+    
+    free(original);
+    free(work);
+    free(reference);
+    return status;
 }
 
 /**
- * Function to add student (for function pointer array)
+ * Function to print the command-line options
  * 
- * @param students Array of Student structures
- * @param count Number of students in the array
+ * @param program Name the program was started with
  */
-void addStudentWrapper(Student students[], int *count) {
-    addNewStudent(students, count);
+void printUsage(const char *program) {
+    printf("Usage: %s                        Interactive menu\n", program);
+    printf("       %s --sort-file IN OUT [--desc] [--stats] [--threads N] [--memory MB] [--tmp DIR]\n", program);
+    printf("           Sort a roster file of \"name,department\" lines ('-' for stdin/stdout);\n");
+    printf("           --stats also counts the students per department in the same pass\n");
+    printf("       %s --bench N [--threads N]\n", program);
+    printf("           Time bubble, merge and parallel sorts on N generated students\n");
 }
 
 /**
  * Main function
  */
-int main() {
-    // Initialize student array with agricultural technology focus
-    Student students[MAX_STUDENTS] = {
+int main(int argc, char *argv[]) {
+    // Batch modes run without the interactive menu
+    if (argc > 1) {
+        const char *input = NULL, *output = NULL, *tmpDir = "/tmp";
+        int descending = 0, benchCount = 0, withStats = 0;
+        long threads = sysconf(_SC_NPROCESSORS_ONLN);
+        long memoryMB = DEFAULT_SORT_MEMORY_MB;
+        
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--sort-file") == 0 && i + 2 < argc) {
+                input = argv[++i];
+                output = argv[++i];
+            } else if (strcmp(argv[i], "--desc") == 0) {
+                descending = 1;
+            } else if (strcmp(argv[i], "--stats") == 0) {
+                withStats = 1;
+            } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+                threads = atol(argv[++i]);
+            } else if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc) {
+                memoryMB = atol(argv[++i]);
+            } else if (strcmp(argv[i], "--tmp") == 0 && i + 1 < argc) {
+                tmpDir = argv[++i];
+            } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+                benchCount = atoi(argv[++i]);
+            } else {
+                printUsage(argv[0]);
+                return strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0 ? 0 : 1;
+            }
+        }
+        if (threads < 1 || threads > MAX_SORT_THREADS || memoryMB < 1) {
+            printf("Error: --threads must be 1-%d and --memory positive.\n", MAX_SORT_THREADS);
+            return 1;
+        }
+        if (benchCount > 0) {
+            int status = runSortBenchmark(benchCount, (int)threads);
+            freeDepartmentTable(&departmentTable);
+            freeNameArena();
+            return status;
+        }
+        if (input == NULL) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        int status = sortRosterFile(input, output, descending, (int)threads, (size_t)memoryMB << 20, tmpDir);
+        // The statistics must not mix with a sorted roster going to stdout
+        if (status == 0 && withStats) {
+            printDepartmentStats(strcmp(output, "-") == 0 ? stderr : stdout, &departmentTable);
+        }
+        freeDepartmentTable(&departmentTable);
+        freeNameArena();
+        return status;
+    }
+    
+    // Initial roster with agricultural technology focus
+    static const char *roster[][2] = {
         {"John Smith", "Crop Science"},
         {"Jane Doe", "Soil Science"},
         {"Michael Johnson", "IoT Systems"},
@@ -323,11 +2309,40 @@ int main() {
         {"Shirley Gibson", "Field Operations"}
     };
     
-    // Determine the actual count of names
-    int count = countNames(students);
+    // The main agricultural departments come first in the statistics,
+    // even before they have students
+    const char *agDepts[] = {"Crop Science", "Soil Science", "IoT Systems", "Data Analytics", "Field Operations"};
+    for (int i = 0; i < 5; i++) {
+        internDepartment(&departmentTable, agDepts[i], strlen(agDepts[i]));
+    }
+    
+    // Load the roster into the student array, count the departments and index the names
+    Student students[MAX_STUDENTS];
+    int count = 0;
+    int rosterSize = (int)(sizeof(roster) / sizeof(roster[0]));
+    int status = initStudentIndex(&studentIndex, ascendingCompare);
+    while (status == 0 && count < rosterSize && count < MAX_STUDENTS) {
+        status = setStudent(&students[count], roster[count][0], strlen(roster[count][0]), roster[count][1],
+                            strlen(roster[count][1]));
+        if (status == 0) {
+            status = indexInsert(&studentIndex, students, count);
+        }
+        if (status == 0) {
+            countStudent(&departmentTable, &students[count]);
+            count++;
+        }
+    }
+    if (status != 0) {
+        printf("Error: Not enough memory for the student roster.\n");
+        freeStudentIndex(&studentIndex);
+        freeDepartmentTable(&departmentTable);
+        freeNameArena();
+        return 1;
+    }
+    countNames(students);
     
     // Array of function pointers with added functionality
-    FunctionPtr functions[3] = {sortNamesWrapper, countNamesWrapper, addStudentWrapper};
+    FunctionPtr functions[4] = {sortNamesWrapper, countNamesWrapper, addStudentWrapper, removeStudentWrapper};
     
     printf("\n===== Agricultural Technology Student Management System =====\n");
     printf("This system demonstrates the use of function pointers and callbacks\n");
@@ -339,21 +2354,23 @@ int main() {
         printf("1. Sort students by name\n");
         printf("2. Count students and show department statistics\n");
         printf("3. Add new student\n");
+        printf("4. Remove student\n");
         printf("0. Exit\n");
-        printf("Enter your choice (0-3): ");
+        printf("Enter your choice (0-4): ");
         scanf("%d", &choice);
         clearInputBuffer();
         
-        if (choice == 1 || choice == 2) {
-            functions[choice - 1](students, count);
-        } else if (choice == 3) {
-            functions[2](students, &count);
+        if (choice >= 1 && choice <= 4) {
+            functions[choice - 1](students, &count);
         } else if (choice != 0) {
-            printf("Invalid choice. Please enter a number between 0 and 3.\n");
+            printf("Invalid choice. Please enter a number between 0 and 4.\n");
         }
     } while (choice != 0);
     
     printf("Program terminated.\n");
     
+    freeStudentIndex(&studentIndex);
+    freeDepartmentTable(&departmentTable);
+    freeNameArena();
     return 0;
 }
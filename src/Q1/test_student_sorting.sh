@@ -0,0 +1,204 @@
+#!/bin/bash
+# Agricultural Technology Student Management System
+# Regression checks for student_sorting: builds the program and compares its
+# sorted rosters with reference outputs from the standard tools.
+#
+# Usage: ./test_student_sorting.sh [--sanitize] [SEED]
+#   --sanitize  build with AddressSanitizer and UndefinedBehaviorSanitizer
+#   SEED        seed for the generated rosters (default 1)
+
+export LC_ALL=C
+cd "$(dirname "$0")" || exit 1
+
+CFLAGS="-O2 -Wall -Wextra"
+if [ "$1" = "--sanitize" ]; then
+    CFLAGS="-g -O1 -fsanitize=address,undefined -fno-sanitize-recover=undefined"
+    shift
+fi
+SEED=${1:-1}
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+PROGRAM="$WORK/student_sorting"
+
+echo "Compiling student_sorting ($CFLAGS)..."
+if ! gcc $CFLAGS -o "$PROGRAM" student_sorting.c -lpthread; then
+    echo "Compilation failed."
+    exit 1
+fi
+
+FAILURES=0
+
+# Function to report one check: check NAME COMMAND...
+check() {
+    local name=$1
+    shift
+    if "$@"; then
+        echo "PASS  $name"
+    else
+        echo "FAIL  $name"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+# Function to write COUNT random "name,department" lines. Names repeat, so
+# stability is exercised, and some are long enough to span many compares.
+generate_roster() {
+    awk -v count="$1" -v seed="$2" 'BEGIN {
+        srand(seed)
+        split("Ana Ben Cleo Dan Eve Femi Gus Hana Ivo Jo Kofi Lea", first, " ")
+        split("Ade Brown Cruz Diallo Evans Fofana Gray Hughes", last, " ")
+        split("Crop Science,Soil Science,IoT Systems,Data Analytics,Field Operations", dept, ",")
+        for (i = 0; i < count; i++) {
+            name = first[int(rand() * 12) + 1] " " last[int(rand() * 8) + 1]
+            if (rand() < 0.5) {
+                name = name " " int(rand() * 50)
+            }
+            printf "%s,%s\n", name, dept[int(rand() * 5) + 1]
+        }
+    }'
+}
+
+# Function to sort a roster file and compare it with `sort -s`:
+# sorted_matches INPUT SORT_FLAGS -- PROGRAM_OPTIONS...
+sorted_matches() {
+    local input=$1 flags=$2
+    shift 3
+    sort -s $flags -t, -k1,1 "$input" > "$WORK/expected"
+    "$PROGRAM" --sort-file "$input" "$WORK/actual" --tmp "$WORK" "$@" 2> /dev/null &&
+        cmp -s "$WORK/expected" "$WORK/actual"
+}
+
+generate_roster 20000 "$SEED" > "$WORK/small.csv"
+generate_roster 60000 "$((SEED + 1))" > "$WORK/large.csv"
+
+check "sort ascending in memory" sorted_matches "$WORK/small.csv" "" --
+check "sort descending in memory" sorted_matches "$WORK/small.csv" "-r" -- --desc
+check "sort in memory on 4 threads" sorted_matches "$WORK/small.csv" "" -- --threads 4
+check "sort descending on 3 threads" sorted_matches "$WORK/small.csv" "-r" -- --desc --threads 3
+# 1 MB holds about 14000 records, so these go through sorted run files
+check "sort through run files" sorted_matches "$WORK/large.csv" "" -- --memory 1
+check "sort descending through run files" sorted_matches "$WORK/large.csv" "-r" -- --memory 1 --desc
+
+# Function to sort stdin to stdout and compare it with `sort -s`
+pipe_matches() {
+    sort -s -t, -k1,1 "$WORK/small.csv" > "$WORK/expected"
+    "$PROGRAM" --sort-file - - < "$WORK/small.csv" 2> /dev/null | cmp -s "$WORK/expected" -
+}
+check "sort from stdin to stdout" pipe_matches
+
+# Function to sort names of every length around the inline limit (11 bytes)
+# and past the 99-byte record limit, where the name is cut
+long_names_match() {
+    awk -v seed="$SEED" 'BEGIN {
+        srand(seed)
+        for (i = 0; i < 20000; i++) {
+            name = ""
+            length_wanted = int(rand() * 130) + 1
+            while (length(name) < length_wanted) {
+                name = name substr("abcdefgh ", int(rand() * 9) + 1, 1)
+            }
+            printf "%s,Dept %d\n", name, int(rand() * 7)
+        }
+    }' > "$WORK/long.csv"
+    awk -F, '{ printf "%s,%s\n", substr($1, 1, 99), $2 }' "$WORK/long.csv" |
+        sort -s -t, -k1,1 > "$WORK/expected"
+    "$PROGRAM" --sort-file "$WORK/long.csv" "$WORK/actual" --memory 1 2> /dev/null &&
+        cmp -s "$WORK/expected" "$WORK/actual"
+}
+check "sort names from 1 to 130 bytes" long_names_match
+
+# Function to compare --stats with department counts in order of first appearance
+stats_match() {
+    awk -F, '!($2 in seen) { seen[$2] = 1; order[++n] = $2 } { count[$2]++ }
+        END { for (i = 1; i <= n; i++) printf "%s: %d students\n", order[i], count[order[i]] }' \
+        "$WORK/large.csv" > "$WORK/expected"
+    "$PROGRAM" --sort-file "$WORK/large.csv" /dev/null --stats --memory 1 2> /dev/null |
+        grep ' students$' > "$WORK/actual" &&
+        cmp -s "$WORK/expected" "$WORK/actual"
+}
+check "department statistics" stats_match
+
+# --bench fails when the bubble, merge and parallel sorts disagree
+bench_agrees() {
+    "$PROGRAM" --bench 5000 --threads 4 > /dev/null
+}
+check "bench sorts agree" bench_agrees
+
+# Function to drive the interactive menu through random adds, removes and
+# listings, and compare every listing with an awk model of the roster. The
+# model keeps students in the order they were added, removes the earliest
+# one with a name, and lists them with a stable sort, as the index must.
+index_matches() {
+    # The initial roster has no repeated names, so its listing is a valid start
+    printf '1\nasc\n0\n' | "$PROGRAM" | grep -E '^[0-9]+ +' |
+        awk '{ name = substr($0, 7, 30); sub(/ +$/, "", name); print name "\t" substr($0, 38) }' |
+        sed 's/ *$//' > "$WORK/roster"
+    [ -s "$WORK/roster" ] || return 1
+
+    awk -F'\t' -v seed="$SEED" -v ops=4000 -v max=100 \
+        -v input="$WORK/session" -v expected="$WORK/expected" '
+    function poolName(  k) {
+        k = int(rand() * 30)
+        if (k < 10) return "Ana " k                                 # stored inline
+        if (k < 20) return "Agricultural student number " (k - 10)  # in the name arena
+        return (k < 25 ? "Ivo Brown " : "Ivo Browne ") (k % 5)       # 11 and 12 bytes
+    }
+    function before(a, b, descending) {
+        return descending ? name[a] > name[b] : name[a] < name[b]
+    }
+    function listing(descending,   i, j, t, order) {
+        for (i = 1; i <= n; i++) {
+            t = i
+            for (j = i - 1; j >= 1 && before(t, order[j], descending); j--) {
+                order[j + 1] = order[j]
+            }
+            order[j + 1] = t
+        }
+        for (i = 1; i <= n; i++) {
+            printf "%-5d %-30s %-20s\n", i, name[order[i]], dept[order[i]] > expected
+        }
+    }
+    { n++; name[n] = $1; dept[n] = $2 }
+    END {
+        srand(seed)
+        split("Crop Science,Soil Science,IoT Systems,Data Analytics,Field Operations", depts, ",")
+        for (op = 0; op < ops; op++) {
+            r = rand()
+            if (r < 0.4) {
+                printf "3\n" > input
+                if (n >= max) continue      # refused before the name is asked for
+                n++
+                name[n] = poolName()
+                dept[n] = depts[int(rand() * 5) + 1]
+                printf "%s\n%s\n", name[n], dept[n] > input
+            } else if (r < 0.85) {
+                nm = n > 0 && rand() < 0.7 ? name[int(rand() * n) + 1] : poolName()
+                printf "4\n%s\n", nm > input
+                for (i = 1; i <= n && name[i] != nm; i++) {
+                }
+                if (i <= n) {
+                    for (; i < n; i++) {
+                        name[i] = name[i + 1]
+                        dept[i] = dept[i + 1]
+                    }
+                    n--
+                }
+            } else {
+                descending = rand() < 0.5
+                printf "1\n%s\n", descending ? "desc" : "asc" > input
+                listing(descending)
+            }
+        }
+        printf "1\nasc\n1\ndesc\n0\n" > input
+        listing(0)
+        listing(1)
+    }' "$WORK/roster"
+
+    "$PROGRAM" < "$WORK/session" | grep -E '^[0-9]+ +' > "$WORK/actual" &&
+        cmp -s "$WORK/expected" "$WORK/actual"
+}
+check "roster index under random adds and removes" index_matches
+
+echo "$FAILURES check(s) failed."
+[ "$FAILURES" -eq 0 ]
@@ -7,22 +7,106 @@
  * for time-sensitive agricultural decisions.
  * 
  * Key features:
- * - Parallel processing using multiple threads
- * - Thread synchronization with mutex locks
- * - Dynamic workload distribution
- * - Performance comparison with single-threaded approach
- * - Simulated agricultural sensor data processing
+ * - Parallel processing using a persistent work-stealing thread pool
+ * - Thread count sized to the machine (overridable via --threads or SENSOR_THREADS)
+ * - Single fused parallel pass for the total, per-type and per-sector aggregates
+ * - Lock-free reduction of cache-line-aligned per-worker results
+ * - Optional thread pinning with NUMA first-touch placement of generated data
+ * - Optional huge-page backing (THP or 2 MB/1 GB hugetlb pages) for reading buffers
+ * - Optional per-worker, per-phase hardware counters via perf_event_open
+ * - Live ingest through lock-free rings with 1/5/60-minute sliding-window statistics
+ * - Dynamic workload distribution in chunks that idle workers can steal
+ * - Column-oriented compact storage (8 bytes per timestamped reading instead of 16)
+ * - Incremental time-bucketed rolling statistics (Welford) per sector and sensor type
+ * - Mergeable per-worker distribution sketches (fixed-bin histograms or KLL) for percentiles
+ * - Filtered, grouped queries that skip blocks via zone maps and bitmap indexes
+ * - Documented binary dataset format that is memory-mapped and aggregated in place
+ * - Compressed block archive (bit-packing, frame of reference, RLE/dictionary, delta timestamps)
+ * - Out-of-core streaming through a bounded triple buffer for datasets larger than RAM
+ * - Multi-file ingest with many reads in flight through io_uring (pread fallback)
+ * - Sharded aggregation across worker processes with a coordinator over Unix sockets
+ * - AVX2/SSE2 sum and group-by kernels selected at runtime, with a scalar fallback
+ * - Performance comparison with single-threaded approach (monotonic wall-clock time)
+ * - Benchmark mode with warmup, repeated trials, median/p99 and CSV/JSON output
+ * - Simulated agricultural sensor data, generated in parallel and reproducible by seed
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 #include <pthread.h>
 #include <time.h>
 #include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sched.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <sys/syscall.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+#if defined(__NR_perf_event_open) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#define HAVE_PERF_EVENTS 1
+#endif
+#endif
+
+#if defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
 
-#define NUM_THREADS 10
 #define MIN_ARRAY_SIZE 1000
-#define MAX_SENSOR_VALUE 100
+#define MAX_SENSOR_VALUE 1000
+#define NUM_SENSOR_TYPES 5
+#define NUM_SECTORS 20
+#define NUM_GROUPS (NUM_SENSOR_TYPES * NUM_SECTORS)
+#define COLUMN_ALIGNMENT 64
+#define CACHE_LINE_SIZE 64
+#define MAX_THREADS 1024
+#define DEFAULT_CHUNK_SIZE 65536
+#define SCALING_REPETITIONS 3
+#define STREAM_BUFFERS 3
+#define DEFAULT_STREAM_BATCH (16 * 1024 * 1024)
+#define DEFAULT_INGEST_BATCH (1024 * 1024)
+#define DEFAULT_INGEST_DEPTH 64
+#define MAX_INGEST_DEPTH 4096
+#define MAX_BENCH_POINTS 64
+#define DEFAULT_BENCH_TRIALS 10
+#define DEFAULT_BENCH_WARMUP 1
+#define ROLLING_BUCKET_SECONDS 60
+#define ROLLING_BUCKETS 1440            // one day of one-minute buckets
+#define DEFAULT_ROLLING_WINDOW 3600
+#define GENERATED_EPOCH 1735689600      // 2025-01-01 00:00:00 UTC
+#define DEFAULT_SPAN_SECONDS 86400
+#define DEFAULT_SHARD_TIMEOUT 300       // seconds a worker may spend on one shard
+#define HUGE_PAGE_2MB (2UL << 20)
+#define HUGE_PAGE_1GB (1UL << 30)
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#define KLL_K 200                       // top compactor size; rank error ~1.7/K
+#define KLL_MIN_CAPACITY 8               // lowest compactors never shrink below this
+#define KLL_MAX_LEVELS 48
 
 // Sensor data types for agricultural applications
 typedef enum {
@@ -33,274 +117,6804 @@ typedef enum {
     NUTRIENT_LEVEL
 } SensorType;
 
-// Structure to represent a sensor reading
+// Structure to represent a single sensor reading
+typedef struct {
+    uint16_t value;        // 0..MAX_SENSOR_VALUE
+    uint8_t type;          // SensorType
+    uint8_t field_sector;  // 1..NUM_SECTORS
+    uint32_t timestamp;    // seconds since the Unix epoch
+} SensorReading;
+
+// How reading buffers are backed (--huge-pages)
+typedef enum {
+    PAGES_DEFAULT,          // aligned_alloc; the system THP policy decides
+    PAGES_SMALL,            // anonymous mapping with THP turned off (4 KB pages)
+    PAGES_THP,              // 2 MB aligned anonymous mapping advised MADV_HUGEPAGE
+    PAGES_HUGETLB_2MB,      // MAP_HUGETLB from the reserved 2 MB pool
+    PAGES_HUGETLB_1GB       // MAP_HUGETLB from the reserved 1 GB pool
+} PageMode;
+
+// Column-oriented storage for a batch of readings. Kernels that only need
+// values stream 2 bytes per reading instead of a whole record.
+typedef struct {
+    uint16_t *values;
+    uint8_t *types;
+    uint8_t *sectors;
+    uint32_t *timestamps;   // NULL for datasets written before timestamps existed
+    long long count;
+    void *mapping;          // non-NULL when the columns live in one mapping (file or anonymous)
+    size_t mapping_size;
+    PageMode pages;         // backing actually obtained for an anonymous mapping
+} SensorColumns;
+
+// Sum of all values, and per-type and per-sector counts and sums
+typedef struct {
+    long long sum;          // every value, including readings with out-of-range codes
+    long long type_counts[NUM_SENSOR_TYPES];
+    long long type_sums[NUM_SENSOR_TYPES];
+    long long sector_counts[NUM_SECTORS];
+    long long sector_sums[NUM_SECTORS];
+} GroupTotals;
+
+// Running count, mean, variance and range of one group (Welford's method)
+typedef struct {
+    long long count;
+    double mean;
+    double m2;              // sum of squared deviations from the mean
+    uint16_t min;
+    uint16_t max;
+} RunningStats;
+
+// Time-bucketed statistics for every (type, sector) group. Slots are
+// recycled as time moves forward, so memory stays fixed, new readings are
+// folded in as they arrive, and a query only merges the buckets inside
+// its window instead of rescanning the readings.
+typedef struct {
+    long long bucket_ids[ROLLING_BUCKETS];      // timestamp / ROLLING_BUCKET_SECONDS, or -1
+    RunningStats buckets[ROLLING_BUCKETS][NUM_GROUPS];
+    long long newest_bucket;
+    long long newest_timestamp;
+    long long late;         // readings older than the retained history
+} RollingStats;
+
+// Which mergeable sketch the aggregation pass builds for percentiles
+typedef enum {
+    SKETCH_HISTOGRAM,       // one exact bin per value 0..MAX_SENSOR_VALUE
+    SKETCH_KLL              // KLL quantile sketch; bounded memory for any value range
+} SketchKind;
+
+// KLL sketch: a stack of compactors where an item at level h stands for
+// 2^h inputs. A full level is sorted and every other item is promoted.
+typedef struct {
+    double *levels[KLL_MAX_LEVELS];
+    int sizes[KLL_MAX_LEVELS];
+    int allocated[KLL_MAX_LEVELS];
+    int capacities[KLL_MAX_LEVELS];
+    int num_levels;
+    long long count;
+    double min;
+    double max;
+    uint64_t random;        // coin for choosing odd or even survivors
+} KllSketch;
+
+// Percentile sketches for every (type, sector) group, built per worker
+// and merged after the pass
+typedef struct {
+    SketchKind kind;
+    uint64_t (*bins)[MAX_SENSOR_VALUE + 1];     // [NUM_GROUPS], histogram sketches
+    KllSketch *kll;                             // [NUM_GROUPS], KLL sketches
+    int failed;                                 // a KLL level could not grow; readings were lost
+} DistributionSketch;
+
+typedef long long (*SumKernel)(const uint16_t *values, long long count);
+typedef void (*GroupKernel)(const uint16_t *values, const uint8_t *types, const uint8_t *sectors,
+                            long long count, GroupTotals *totals);
+typedef uint64_t (*RangeMaskKernel)(const uint16_t *values, int count, uint16_t low, uint16_t high);
+
+// Per-worker results for the aggregation pass. Each slot starts on its own
+// cache line so workers updating their results never share a line.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) int thread_id;
+    const SensorColumns *columns;
+    long long readings_processed;
+    long long chunks_processed;
+    long long partial_sum;
+    GroupTotals totals;     // thread-local type and sector histograms
+    DistributionSketch *sketch;     // thread-local percentile sketches, or NULL
+    RollingStats *rolling;          // thread-local rolling buckets, or NULL
+    double processing_time;
+} ThreadData;
+
+// Task run by a pool worker on the item range [begin, end)
+typedef void (*PoolTask)(void *ctx, int worker_id, long long begin, long long end);
+
+// Called once by each participating worker after the job has been drained
+typedef void (*PoolDone)(void *ctx, int worker_id);
+
+// Range of chunk indices owned by one worker; the owner pops from the
+// front while thieves split off the back half
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t lock;
+    long long next;
+    long long end;
+} WorkQueue;
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) ThreadPool *pool;
+    int id;
+    int cpu;                // pinned CPU, or -1
+    int node;               // NUMA node of the pinned CPU
+    pid_t tid;              // kernel thread id, set once the thread runs
+    long long chunks_stolen;
+} PoolWorker;
+
+// Persistent work-stealing thread pool, created once and reused for every job
+struct ThreadPool {
+    int num_workers;
+    pthread_t *threads;
+    PoolWorker *workers;
+    WorkQueue *queues;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    unsigned long generation;
+    int shutdown;
+    int running;
+    int stealing;           // 0 keeps every worker on the chunks it was dealt
+
+    // Current job
+    int active_workers;
+    long long total_items;
+    long long chunk_size;
+    PoolTask task;
+    PoolDone done;
+    void *ctx;
+};
+
+void pool_run(ThreadPool *pool, int active, long long total_items, long long chunk_size,
+              PoolTask task, PoolDone done, void *ctx);
+void pool_destroy(ThreadPool *pool);
+void free_columns(SensorColumns *columns);
+RollingStats *rolling_create();
+void rolling_reset(RollingStats *rolling);
+void rolling_add_range(RollingStats *rolling, const SensorColumns *columns, long long begin, long long end,
+                       long long oldest_bucket);
+void rolling_merge(RollingStats *into, const RollingStats *from);
+
+// Global variables
+SensorColumns sensor_data;
+long long n;
+long long total_sum = 0;
+GroupTotals total_groups;
+ThreadData thread_data[MAX_THREADS];
+RollingStats *rolling_stats = NULL;
+PageMode page_mode = PAGES_DEFAULT;
+
+// Function to map at least '*size' bytes of anonymous memory backed as
+// '*mode' asks. An empty hugetlb pool falls back from 1 GB to 2 MB pages and
+// then to THP; '*mode' and '*size' are updated to what was mapped.
+static void *map_reading_buffer(size_t *size, PageMode *mode) {
+    if (*mode == PAGES_HUGETLB_1GB || *mode == PAGES_HUGETLB_2MB) {
+        size_t page = *mode == PAGES_HUGETLB_1GB ? HUGE_PAGE_1GB : HUGE_PAGE_2MB;
+        int page_shift = *mode == PAGES_HUGETLB_1GB ? 30 : 21;
+        size_t rounded = (*size + page - 1) / page * page;
+        void *base = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (page_shift << MAP_HUGE_SHIFT), -1, 0);
+        if (base != MAP_FAILED) {
+            *size = rounded;
+            return base;
+        }
+        *mode = *mode == PAGES_HUGETLB_1GB ? PAGES_HUGETLB_2MB : PAGES_THP;
+        return map_reading_buffer(size, mode);
+    }
+
+    // Over-map by one huge page and trim, so the buffer starts on a 2 MB
+    // boundary and THP can back all of it
+    size_t rounded = (*size + HUGE_PAGE_2MB - 1) / HUGE_PAGE_2MB * HUGE_PAGE_2MB;
+    char *raw = (char *)mmap(NULL, rounded + HUGE_PAGE_2MB, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+    char *base = (char *)(((uintptr_t)raw + HUGE_PAGE_2MB - 1) & ~(uintptr_t)(HUGE_PAGE_2MB - 1));
+    if (base > raw) {
+        munmap(raw, base - raw);
+    }
+    munmap(base + rounded, raw + HUGE_PAGE_2MB - base);
+    madvise(base, rounded, *mode == PAGES_THP ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    *size = rounded;
+    return base;
+}
+
+// Function to allocate the value, type, sector and timestamp columns for
+// 'count' readings with the given page backing. Buffers smaller than a huge
+// page always come from aligned_alloc.
+int allocate_columns_paged(SensorColumns *columns, long long count, PageMode mode) {
+    // aligned_alloc needs sizes that are a multiple of the alignment
+    size_t value_bytes = (count * sizeof(uint16_t) + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+    size_t byte_column = (count + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+    size_t timestamp_bytes = (count * sizeof(uint32_t) + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+    size_t total = value_bytes + 2 * byte_column + timestamp_bytes;
+
+    if (mode != PAGES_DEFAULT && total >= HUGE_PAGE_2MB) {
+        // One mapping holds all four columns, each starting on a cache line
+        if (mode == PAGES_HUGETLB_1GB && total < HUGE_PAGE_1GB) {
+            mode = PAGES_HUGETLB_2MB;
+        }
+        size_t size = total;
+        char *base = (char *)map_reading_buffer(&size, &mode);
+        memset(columns, 0, sizeof(*columns));
+        if (base == NULL) {
+            return -1;
+        }
+        columns->values = (uint16_t *)base;
+        columns->types = (uint8_t *)(base + value_bytes);
+        columns->sectors = columns->types + byte_column;
+        columns->timestamps = (uint32_t *)(columns->sectors + byte_column);
+        columns->count = count;
+        columns->mapping = base;
+        columns->mapping_size = size;
+        columns->pages = mode;
+        return 0;
+    }
+
+    columns->values = (uint16_t *)aligned_alloc(COLUMN_ALIGNMENT, value_bytes);
+    columns->types = (uint8_t *)aligned_alloc(COLUMN_ALIGNMENT, byte_column);
+    columns->sectors = (uint8_t *)aligned_alloc(COLUMN_ALIGNMENT, byte_column);
+    columns->timestamps = (uint32_t *)aligned_alloc(COLUMN_ALIGNMENT, timestamp_bytes);
+    columns->count = count;
+    columns->mapping = NULL;
+    columns->mapping_size = 0;
+    columns->pages = PAGES_DEFAULT;
+
+    if (columns->values == NULL || columns->types == NULL || columns->sectors == NULL ||
+        columns->timestamps == NULL) {
+        free_columns(columns);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to allocate columns for 'count' readings backed as --huge-pages asks
+int allocate_columns(SensorColumns *columns, long long count) {
+    return allocate_columns_paged(columns, count, page_mode);
+}
+
+// Function to release the columns of a batch (heap-allocated or mapped)
+void free_columns(SensorColumns *columns) {
+    if (columns->mapping != NULL) {
+        munmap(columns->mapping, columns->mapping_size);
+    } else {
+        free(columns->values);
+        free(columns->types);
+        free(columns->sectors);
+        free(columns->timestamps);
+    }
+    memset(columns, 0, sizeof(*columns));
+}
+
+// Function to report how the columns are backed: the hugetlb pages of the
+// mapping, or how much of it transparent huge pages cover (AnonHugePages of
+// the overlapping VMAs in /proc/self/smaps)
+void print_page_backing(const char *label, const SensorColumns *columns) {
+    static const char *mode_names[] = {"default allocation", "4 KB pages", "THP requested",
+                                       "2 MB hugetlb pages", "1 GB hugetlb pages"};
+    uintptr_t begin = (uintptr_t)columns->mapping;
+    uintptr_t end = begin + columns->mapping_size;
+    if (columns->mapping == NULL) {
+        // Separately allocated columns: the span from the lowest to the highest
+        const uintptr_t starts[4] = {(uintptr_t)columns->values, (uintptr_t)columns->types,
+                                     (uintptr_t)columns->sectors, (uintptr_t)columns->timestamps};
+        const size_t sizes[4] = {columns->count * sizeof(uint16_t), (size_t)columns->count,
+                                 (size_t)columns->count, columns->count * sizeof(uint32_t)};
+        begin = UINTPTR_MAX;
+        end = 0;
+        for (int c = 0; c < 4; c++) {
+            if (starts[c] != 0) {
+                begin = starts[c] < begin ? starts[c] : begin;
+                end = starts[c] + sizes[c] > end ? starts[c] + sizes[c] : end;
+            }
+        }
+    }
+    double total_mb = (end - begin) / 1048576.0;
+    if (columns->pages == PAGES_DEFAULT && page_mode != PAGES_DEFAULT) {
+        printf("%s: %.1f KB, smaller than a huge page (default allocation)\n", label, (end - begin) / 1024.0);
+        return;
+    }
+
+    if (columns->pages == PAGES_HUGETLB_2MB || columns->pages == PAGES_HUGETLB_1GB) {
+        size_t page = columns->pages == PAGES_HUGETLB_1GB ? HUGE_PAGE_1GB : HUGE_PAGE_2MB;
+        printf("%s: %.1f MB on %zu %s%s\n", label, total_mb, columns->mapping_size / page,
+               mode_names[columns->pages], columns->pages != page_mode ? " (fell back)" : "");
+        return;
+    }
+
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    if (smaps == NULL) {
+        printf("%s: %.1f MB (%s); /proc/self/smaps unavailable\n", label, total_mb,
+               mode_names[columns->pages]);
+        return;
+    }
+    char line[256];
+    int overlaps = 0;
+    unsigned long long huge_kb = 0;
+    while (fgets(line, sizeof(line), smaps) != NULL) {
+        unsigned long vma_start, vma_end;
+        unsigned long long kb;
+        if (sscanf(line, "%lx-%lx ", &vma_start, &vma_end) == 2) {
+            overlaps = vma_start < end && vma_end > begin;
+        } else if (overlaps && sscanf(line, "AnonHugePages: %llu kB", &kb) == 1) {
+            huge_kb += kb;
+        }
+    }
+    fclose(smaps);
+    double huge_mb = huge_kb / 1024.0;
+    printf("%s: %.1f MB (%s%s), %.1f MB (%.0f%%) on transparent huge pages\n", label, total_mb,
+           mode_names[columns->pages],
+           page_mode >= PAGES_HUGETLB_2MB && columns->pages == PAGES_THP ? ", hugetlb pool empty" : "",
+           huge_mb, total_mb > 0 ? 100.0 * (huge_mb < total_mb ? huge_mb : total_mb) / total_mb : 0.0);
+}
+
+// Function to store one reading into the columns at 'index'
+static inline void store_reading(SensorColumns *columns, long long index, SensorReading reading) {
+    columns->values[index] = reading.value;
+    columns->types[index] = reading.type;
+    columns->sectors[index] = reading.field_sector;
+    columns->timestamps[index] = reading.timestamp;
+}
+
+// Upper bound of the generated value for each sensor type
+static const int sensor_value_range[NUM_SENSOR_TYPES] = {
+    100,    // Soil moisture (0-100%)
+    50,     // Temperature (0-50°C)
+    100,    // Humidity (0-100%)
+    1000,   // Light intensity (0-1000 lux)
+    100     // Nutrient level (0-100 ppm)
+};
+
+// Counter-based generator (SplitMix64 finalizer): the random bits for
+// reading 'index' depend only on the seed and the index, so any thread can
+// produce any slice and the data never depends on the thread count.
+static inline uint64_t reading_bits(uint64_t seed, uint64_t index) {
+    uint64_t z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Function to derive the reading at 'index' of the dataset for 'seed',
+// stamped with 'timestamp'
+static inline SensorReading make_reading(uint64_t seed, uint64_t index, uint32_t timestamp) {
+    uint64_t bits = reading_bits(seed, index);
+    uint64_t low = (uint32_t)bits;
+    uint64_t high = bits >> 32;
+    SensorReading reading;
+
+    // Multiply-shift maps 32 random bits onto [0, range) without division;
+    // the leftover low half of the first product feeds the sector choice
+    uint64_t type_product = low * NUM_SENSOR_TYPES;
+    reading.type = (uint8_t)(type_product >> 32);
+    reading.field_sector = (uint8_t)((((uint32_t)type_product) * (uint64_t)NUM_SECTORS >> 32) + 1);
+    reading.value = (uint16_t)((high * (sensor_value_range[reading.type] + 1)) >> 32);
+    reading.timestamp = timestamp;
+    return reading;
+}
+
+// Generated readings are spread evenly over 'span' seconds from a fixed
+// epoch, so the timestamps are reproducible too
+typedef struct {
+    SensorColumns *columns;
+    uint64_t seed;
+    uint64_t count;
+    uint64_t span;
+} GenerateJob;
+
+// Pool task to generate one chunk of readings
+void generate_chunk(void *ctx, int worker_id, long long begin, long long end) {
+    const GenerateJob *job = (const GenerateJob *)ctx;
+
+    // Reading i is stamped floor(i * span / count) seconds after the epoch.
+    // i * span overflows 64 bits for multi-billion datasets over long spans,
+    // so the 128-bit product is taken once per chunk and then stepped by
+    // span / count with a remainder, which also avoids a division per reading.
+    unsigned __int128 start = (unsigned __int128)(uint64_t)begin * job->span;
+    uint64_t offset = (uint64_t)(start / job->count);
+    uint64_t remainder = (uint64_t)(start % job->count);
+    uint64_t step = job->span / job->count;
+    uint64_t step_remainder = job->span % job->count;
+
+    for (long long i = begin; i < end; i++) {
+        store_reading(job->columns, i, make_reading(job->seed, i, (uint32_t)(GENERATED_EPOCH + offset)));
+        offset += step;
+        remainder += step_remainder;
+        if (remainder >= job->count) {
+            remainder -= job->count;
+            offset++;
+        }
+    }
+    thread_data[worker_id].readings_processed += end - begin;
+}
+
+// Function to fill 'columns' with generated readings in parallel across the pool
+void generate_columns(ThreadPool *pool, int active, long long chunk_size, SensorColumns *columns,
+                      uint64_t seed, long long span) {
+    GenerateJob job = {columns, seed, (uint64_t)columns->count, (uint64_t)span};
+    for (int i = 0; i < pool->num_workers; i++) {
+        thread_data[i].readings_processed = 0;
+    }
+    pool_run(pool, active, columns->count, chunk_size, generate_chunk, NULL, &job);
+}
+
+// Function to generate simulated sensor data in parallel across the pool
+void generate_sensor_data(ThreadPool *pool, int active, long long chunk_size, uint64_t seed, long long span) {
+    printf("Generating simulated agricultural sensor data (seed %llu, %lld s span)...\n",
+           (unsigned long long)seed, span);
+    generate_columns(pool, active, chunk_size, &sensor_data, seed, span);
+}
+
+// Scalar reference kernel: sum of values
+long long sum_values_scalar(const uint16_t *values, long long count) {
+    long long sum = 0;
+    for (long long i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+// Scalar reference kernel: sum of all values, and per-type and per-sector
+// counts and sums. Out-of-range codes (only possible in a corrupt mapped
+// file) are left out of the groups but not the sum, matching the SIMD
+// kernels, which only count exact matches.
+void group_values_scalar(const uint16_t *values, const uint8_t *types, const uint8_t *sectors,
+                         long long count, GroupTotals *totals) {
+    for (long long i = 0; i < count; i++) {
+        unsigned type = types[i];
+        unsigned sector = sectors[i] - 1u;
+        totals->sum += values[i];
+        if (type < NUM_SENSOR_TYPES) {
+            totals->type_counts[type]++;
+            totals->type_sums[type] += values[i];
+        }
+        if (sector < NUM_SECTORS) {
+            totals->sector_counts[sector]++;
+            totals->sector_sums[sector] += values[i];
+        }
+    }
+}
+
+// Scalar reference kernel: bit i set when low <= values[i] <= high (count <= 64)
+uint64_t range_mask_scalar(const uint16_t *values, int count, uint16_t low, uint16_t high) {
+    uint64_t mask = 0;
+    for (int i = 0; i < count; i++) {
+        mask |= (uint64_t)(values[i] >= low && values[i] <= high) << i;
+    }
+    return mask;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+// 32-bit lane accumulators are flushed to 64 bits after this many vectors,
+// long before adding 2 * MAX_SENSOR_VALUE per step could overflow them.
+// Larger values (only a corrupt or foreign mapped file or archive holds
+// them) would break that bound and the signed 16-bit madd, so each block
+// notes them with a saturating subtract and is redone by the scalar kernel.
+#define SIMD_FLUSH_INTERVAL 65536
+
+// SSE2 kernel: pairwise-add 8 values per step into four 32-bit lanes
+long long sum_values_sse2(const uint16_t *values, long long count) {
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i bound = _mm_set1_epi16(MAX_SENSOR_VALUE);
+    long long sum = 0;
+    long long i = 0;
+
+    while (i + 8 <= count) {
+        __m128i acc = _mm_setzero_si128();
+        __m128i over = _mm_setzero_si128();
+        long long block = i;
+        long long stop = i + 8LL * SIMD_FLUSH_INTERVAL;
+        if (stop > count) {
+            stop = count;
+        }
+        for (; i + 8 <= stop; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+            over = _mm_or_si128(over, _mm_subs_epu16(v, bound));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(v, ones));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(over, _mm_setzero_si128())) != 0xffff) {
+            sum += sum_values_scalar(values + block, i - block);
+            continue;
+        }
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, acc);
+        sum += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+    return sum + sum_values_scalar(values + i, count - i);
+}
+
+// SSE2 kernel: masked per-group sums over 8 readings per step
+void group_values_sse2(const uint16_t *values, const uint8_t *types, const uint8_t *sectors,
+                       long long count, GroupTotals *totals) {
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bound = _mm_set1_epi16(MAX_SENSOR_VALUE);
+    long long i = 0;
+
+    while (i + 8 <= count) {
+        __m128i type_acc[NUM_SENSOR_TYPES];
+        __m128i sector_acc[NUM_SECTORS];
+        for (int t = 0; t < NUM_SENSOR_TYPES; t++) type_acc[t] = zero;
+        for (int s = 0; s < NUM_SECTORS; s++) sector_acc[s] = zero;
+        __m128i value_acc = zero;
+        __m128i over = zero;
+        GroupTotals before = *totals;
+        long long block = i;
+
+        long long stop = i + 8LL * SIMD_FLUSH_INTERVAL;
+        if (stop > count) {
+            stop = count;
+        }
+        for (; i + 8 <= stop; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(values + i));
+            over = _mm_or_si128(over, _mm_subs_epu16(v, bound));
+            value_acc = _mm_add_epi32(value_acc, _mm_madd_epi16(v, ones));
+            __m128i ty = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(types + i)), zero);
+            __m128i se = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(sectors + i)), zero);
+
+            for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+                __m128i mask = _mm_cmpeq_epi16(ty, _mm_set1_epi16(t));
+                totals->type_counts[t] += __builtin_popcount(_mm_movemask_epi8(mask)) / 2;
+                type_acc[t] = _mm_add_epi32(type_acc[t], _mm_madd_epi16(_mm_and_si128(v, mask), ones));
+            }
+            for (int s = 0; s < NUM_SECTORS; s++) {
+                __m128i mask = _mm_cmpeq_epi16(se, _mm_set1_epi16(s + 1));
+                totals->sector_counts[s] += __builtin_popcount(_mm_movemask_epi8(mask)) / 2;
+                sector_acc[s] = _mm_add_epi32(sector_acc[s], _mm_madd_epi16(_mm_and_si128(v, mask), ones));
+            }
+        }
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(over, zero)) != 0xffff) {
+            *totals = before;
+            group_values_scalar(values + block, types + block, sectors + block, i - block, totals);
+            continue;
+        }
+
+        int32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, value_acc);
+        totals->sum += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+            _mm_storeu_si128((__m128i *)lanes, type_acc[t]);
+            totals->type_sums[t] += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+        for (int s = 0; s < NUM_SECTORS; s++) {
+            _mm_storeu_si128((__m128i *)lanes, sector_acc[s]);
+            totals->sector_sums[s] += (long long)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+    }
+    group_values_scalar(values + i, types + i, sectors + i, count - i, totals);
+}
+
+// SSE2 kernel: range predicate over 8 values per step. SSE2 only compares
+// signed 16-bit lanes, so both sides are biased by 0x8000 first.
+uint64_t range_mask_sse2(const uint16_t *values, int count, uint16_t low, uint16_t high) {
+    const __m128i bias = _mm_set1_epi16((short)0x8000);
+    const __m128i lo = _mm_xor_si128(_mm_set1_epi16((short)low), bias);
+    const __m128i hi = _mm_xor_si128(_mm_set1_epi16((short)high), bias);
+    uint64_t mask = 0;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(values + i)), bias);
+        __m128i outside = _mm_or_si128(_mm_cmplt_epi16(v, lo), _mm_cmpgt_epi16(v, hi));
+        unsigned bits = _mm_movemask_epi8(_mm_packs_epi16(outside, _mm_setzero_si128())) & 0xff;
+        mask |= (uint64_t)(~bits & 0xff) << i;
+    }
+    return i < count ? mask | range_mask_scalar(values + i, count - i, low, high) << i : mask;
+}
+
+// AVX2 kernel: pairwise-add 16 values per step into eight 32-bit lanes
+__attribute__((target("avx2")))
+long long sum_values_avx2(const uint16_t *values, long long count) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i bound = _mm256_set1_epi16(MAX_SENSOR_VALUE);
+    long long sum = 0;
+    long long i = 0;
+
+    while (i + 16 <= count) {
+        __m256i acc = _mm256_setzero_si256();
+        __m256i over = _mm256_setzero_si256();
+        long long block = i;
+        long long stop = i + 16LL * SIMD_FLUSH_INTERVAL;
+        if (stop > count) {
+            stop = count;
+        }
+        for (; i + 16 <= stop; i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+            over = _mm256_or_si256(over, _mm256_subs_epu16(v, bound));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(v, ones));
+        }
+        if (!_mm256_testz_si256(over, over)) {
+            sum += sum_values_scalar(values + block, i - block);
+            continue;
+        }
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, acc);
+        for (int k = 0; k < 8; k++) {
+            sum += lanes[k];
+        }
+    }
+    return sum + sum_values_scalar(values + i, count - i);
+}
+
+// AVX2 kernel: masked per-group sums over 16 readings per step
+__attribute__((target("avx2")))
+void group_values_avx2(const uint16_t *values, const uint8_t *types, const uint8_t *sectors,
+                       long long count, GroupTotals *totals) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i bound = _mm256_set1_epi16(MAX_SENSOR_VALUE);
+    long long i = 0;
+
+    while (i + 16 <= count) {
+        __m256i type_acc[NUM_SENSOR_TYPES];
+        __m256i sector_acc[NUM_SECTORS];
+        for (int t = 0; t < NUM_SENSOR_TYPES; t++) type_acc[t] = _mm256_setzero_si256();
+        for (int s = 0; s < NUM_SECTORS; s++) sector_acc[s] = _mm256_setzero_si256();
+        __m256i value_acc = _mm256_setzero_si256();
+        __m256i over = _mm256_setzero_si256();
+        GroupTotals before = *totals;
+        long long block = i;
+
+        long long stop = i + 16LL * SIMD_FLUSH_INTERVAL;
+        if (stop > count) {
+            stop = count;
+        }
+        for (; i + 16 <= stop; i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(values + i));
+            over = _mm256_or_si256(over, _mm256_subs_epu16(v, bound));
+            value_acc = _mm256_add_epi32(value_acc, _mm256_madd_epi16(v, ones));
+            __m128i ty = _mm_loadu_si128((const __m128i *)(types + i));
+            __m128i se = _mm_loadu_si128((const __m128i *)(sectors + i));
+
+            for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+                __m128i mask8 = _mm_cmpeq_epi8(ty, _mm_set1_epi8((char)t));
+                totals->type_counts[t] += __builtin_popcount(_mm_movemask_epi8(mask8));
+                __m256i mask = _mm256_cvtepi8_epi16(mask8);
+                type_acc[t] = _mm256_add_epi32(type_acc[t], _mm256_madd_epi16(_mm256_and_si256(v, mask), ones));
+            }
+            for (int s = 0; s < NUM_SECTORS; s++) {
+                __m128i mask8 = _mm_cmpeq_epi8(se, _mm_set1_epi8((char)(s + 1)));
+                totals->sector_counts[s] += __builtin_popcount(_mm_movemask_epi8(mask8));
+                __m256i mask = _mm256_cvtepi8_epi16(mask8);
+                sector_acc[s] = _mm256_add_epi32(sector_acc[s], _mm256_madd_epi16(_mm256_and_si256(v, mask), ones));
+            }
+        }
+
+        if (!_mm256_testz_si256(over, over)) {
+            *totals = before;
+            group_values_scalar(values + block, types + block, sectors + block, i - block, totals);
+            continue;
+        }
+
+        int32_t lanes[8];
+        _mm256_storeu_si256((__m256i *)lanes, value_acc);
+        for (int k = 0; k < 8; k++) totals->sum += lanes[k];
+        for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+            _mm256_storeu_si256((__m256i *)lanes, type_acc[t]);
+            for (int k = 0; k < 8; k++) totals->type_sums[t] += lanes[k];
+        }
+        for (int s = 0; s < NUM_SECTORS; s++) {
+            _mm256_storeu_si256((__m256i *)lanes, sector_acc[s]);
+            for (int k = 0; k < 8; k++) totals->sector_sums[s] += lanes[k];
+        }
+    }
+    group_values_scalar(values + i, types + i, sectors + i, count - i, totals);
+}
+
+// AVX2 kernel: range predicate over 32 values per step. The pack works
+// within 128-bit lanes, so a cross-lane permute restores reading order.
+__attribute__((target("avx2")))
+uint64_t range_mask_avx2(const uint16_t *values, int count, uint16_t low, uint16_t high) {
+    const __m256i bias = _mm256_set1_epi16((short)0x8000);
+    const __m256i lo = _mm256_xor_si256(_mm256_set1_epi16((short)low), bias);
+    const __m256i hi = _mm256_xor_si256(_mm256_set1_epi16((short)high), bias);
+    uint64_t mask = 0;
+    int i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(values + i)), bias);
+        __m256i b = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(values + i + 16)), bias);
+        __m256i out_a = _mm256_or_si256(_mm256_cmpgt_epi16(lo, a), _mm256_cmpgt_epi16(a, hi));
+        __m256i out_b = _mm256_or_si256(_mm256_cmpgt_epi16(lo, b), _mm256_cmpgt_epi16(b, hi));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(out_a, out_b), 0xd8);
+        mask |= (uint64_t)(~(uint32_t)_mm256_movemask_epi8(packed)) << i;
+    }
+    return i < count ? mask | range_mask_sse2(values + i, count - i, low, high) << i : mask;
+}
+
+#endif
+
+// Kernels chosen by select_kernels()
+SumKernel sum_kernel = sum_values_scalar;
+GroupKernel group_kernel = group_values_scalar;
+RangeMaskKernel range_mask_kernel = range_mask_scalar;
+const char *kernel_name = "scalar";
+
+// Function to pick the widest kernels the CPU supports, or the ones named
+// by 'requested' ("avx2", "sse2" or "scalar"). Returns 0 on success.
+int select_kernels(const char *requested) {
+    sum_kernel = sum_values_scalar;
+    group_kernel = group_values_scalar;
+    range_mask_kernel = range_mask_scalar;
+    kernel_name = "scalar";
+
+    if (requested != NULL && strcmp(requested, "scalar") == 0) {
+        return 0;
+    }
+
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    int any = requested == NULL;
+    if ((any || strcmp(requested, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        sum_kernel = sum_values_avx2;
+        group_kernel = group_values_avx2;
+        range_mask_kernel = range_mask_avx2;
+        kernel_name = "avx2";
+        return 0;
+    }
+    if ((any || strcmp(requested, "sse2") == 0) && __builtin_cpu_supports("sse2")) {
+        sum_kernel = sum_values_sse2;
+        group_kernel = group_values_sse2;
+        range_mask_kernel = range_mask_sse2;
+        kernel_name = "sse2";
+        return 0;
+    }
+#endif
+    return requested == NULL ? 0 : -1;
+}
+
+/*
+ * On-disk dataset format (little-endian, version 2)
+ *
+ *   offset  size  field
+ *   0       8     magic "AGSENSOR"
+ *   8       4     schema version (DATASET_VERSION)
+ *   12      4     header size in bytes (DATASET_HEADER_SIZE)
+ *   16      8     number of readings
+ *   24      8     checksum of the columns (see dataset_checksum)
+ *   32      8     byte offset of the uint16_t value column
+ *   40      8     byte offset of the uint8_t type column
+ *   48      8     byte offset of the uint8_t sector column
+ *   56      8     byte offset of the uint32_t timestamp column
+ *
+ * Each column starts on a COLUMN_ALIGNMENT boundary and holds exactly
+ * 'count' entries, so a mapped file can be aggregated in place. Version 1
+ * files have no timestamp column (offset 56 is zero) and are still read.
+ */
+#define DATASET_MAGIC "AGSENSOR"
+#define DATASET_VERSION 2
+#define DATASET_HEADER_SIZE 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t count;
+    uint64_t checksum;
+    uint64_t values_offset;
+    uint64_t types_offset;
+    uint64_t sectors_offset;
+    uint64_t timestamps_offset;
+} DatasetHeader;
+
+_Static_assert(sizeof(DatasetHeader) == DATASET_HEADER_SIZE, "dataset header layout");
+
+// Function to round a file offset up to the column alignment
+static uint64_t align_offset(uint64_t offset) {
+    return (offset + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+}
+
+// Function to fold 'length' bytes into a running FNV-1a style hash, one
+// 64-bit word at a time (the tail is zero-padded)
+uint64_t checksum_update(uint64_t hash, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t i = 0;
+
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    if (i < length) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, length - i);
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Function to compute the checksum stored in a dataset header
+uint64_t dataset_checksum(const SensorColumns *columns) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    hash = checksum_update(hash, columns->values, columns->count * sizeof(uint16_t));
+    hash = checksum_update(hash, columns->types, columns->count);
+    hash = checksum_update(hash, columns->sectors, columns->count);
+    if (columns->timestamps != NULL) {
+        hash = checksum_update(hash, columns->timestamps, columns->count * sizeof(uint32_t));
+    }
+    return hash;
+}
+
+// Function to fill in the header (offsets and checksum) for 'columns'
+void build_dataset_header(DatasetHeader *header, const SensorColumns *columns) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, DATASET_MAGIC, 8);
+    header->version = DATASET_VERSION;
+    header->header_size = DATASET_HEADER_SIZE;
+    header->count = columns->count;
+    header->checksum = dataset_checksum(columns);
+    header->values_offset = align_offset(DATASET_HEADER_SIZE);
+    header->types_offset = align_offset(header->values_offset + columns->count * sizeof(uint16_t));
+    header->sectors_offset = align_offset(header->types_offset + columns->count);
+    header->timestamps_offset = align_offset(header->sectors_offset + columns->count);
+}
+
+// Function to write 'length' bytes at the current offset, padding with
+// zeros up to 'target' first
+static int write_at(FILE *file, uint64_t *offset, uint64_t target, const void *data, size_t length) {
+    static const char zeros[COLUMN_ALIGNMENT] = {0};
+    while (*offset < target) {
+        size_t pad = target - *offset < sizeof(zeros) ? target - *offset : sizeof(zeros);
+        if (fwrite(zeros, 1, pad, file) != pad) {
+            return -1;
+        }
+        *offset += pad;
+    }
+    if (length > 0 && fwrite(data, 1, length, file) != length) {
+        return -1;
+    }
+    *offset += length;
+    return 0;
+}
+
+// Function to save a batch of readings in the on-disk dataset format
+int write_dataset(const char *path, const SensorColumns *columns) {
+    DatasetHeader header;
+    build_dataset_header(&header, columns);
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Failed to create dataset file");
+        return -1;
+    }
+
+    uint64_t offset = 0;
+    int status = 0;
+    status |= write_at(file, &offset, 0, &header, sizeof(header));
+    status |= write_at(file, &offset, header.values_offset, columns->values, columns->count * sizeof(uint16_t));
+    status |= write_at(file, &offset, header.types_offset, columns->types, columns->count);
+    status |= write_at(file, &offset, header.sectors_offset, columns->sectors, columns->count);
+    status |= write_at(file, &offset, header.timestamps_offset, columns->timestamps,
+                       columns->count * sizeof(uint32_t));
+
+    if (fclose(file) != 0 || status != 0) {
+        perror("Failed to write dataset file");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to check a header against the size of the file it came from
+int validate_dataset_header(const DatasetHeader *header, uint64_t file_size) {
+    if (memcmp(header->magic, DATASET_MAGIC, 8) != 0) {
+        printf("Error: not a sensor dataset (bad magic)\n");
+        return -1;
+    }
+    if (header->version < 1 || header->version > DATASET_VERSION ||
+        header->header_size != DATASET_HEADER_SIZE) {
+        printf("Error: unsupported dataset schema version %u\n", header->version);
+        return -1;
+    }
+
+    uint64_t count = header->count;
+    if (header->values_offset < DATASET_HEADER_SIZE ||
+        header->values_offset % COLUMN_ALIGNMENT != 0 ||
+        header->types_offset % COLUMN_ALIGNMENT != 0 ||
+        header->sectors_offset % COLUMN_ALIGNMENT != 0 ||
+        header->values_offset > file_size || count * 2 > file_size - header->values_offset ||
+        header->types_offset > file_size || count > file_size - header->types_offset ||
+        header->sectors_offset > file_size || count > file_size - header->sectors_offset) {
+        printf("Error: dataset header does not match the file size (truncated file?)\n");
+        return -1;
+    }
+    if (header->version >= 2 &&
+        (header->timestamps_offset % COLUMN_ALIGNMENT != 0 || header->timestamps_offset > file_size ||
+         count * 4 > file_size - header->timestamps_offset)) {
+        printf("Error: dataset header does not match the file size (truncated file?)\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to start read-ahead of readings [first, first + count) of a
+// mapped dataset, in every column a pass over them reads
+void prefetch_readings(const SensorColumns *columns, long long first, long long count) {
+    const long page = sysconf(_SC_PAGESIZE);
+    const struct { const void *start; size_t width; } ranges[4] = {
+        {columns->values, sizeof(uint16_t)}, {columns->types, 1}, {columns->sectors, 1},
+        {columns->timestamps, sizeof(uint32_t)}};
+    for (int c = 0; c < 4; c++) {
+        if (ranges[c].start == NULL) {
+            continue;
+        }
+        uintptr_t begin = (uintptr_t)ranges[c].start + first * ranges[c].width;
+        uintptr_t end = begin + count * ranges[c].width;
+        begin &= ~(uintptr_t)(page - 1);
+        madvise((void *)begin, end - begin, MADV_WILLNEED);
+    }
+}
+
+// Function to map a dataset file and point 'columns' straight into the
+// mapping. Nothing is copied or parsed; pages are faulted in as the
+// workers sweep them. With 'verify' set, the checksum is checked first.
+int map_dataset(const char *path, SensorColumns *columns, int verify) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open dataset file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < DATASET_HEADER_SIZE) {
+        printf("Error: '%s' is too small to be a sensor dataset\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map dataset file");
+        return -1;
+    }
+
+    const DatasetHeader *header = (const DatasetHeader *)mapping;
+    if (validate_dataset_header(header, st.st_size) != 0) {
+        munmap(mapping, st.st_size);
+        return -1;
+    }
+
+    // The sweep is strictly sequential; read-ahead of the ranges actually
+    // aggregated is requested with prefetch_readings
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+    columns->values = (uint16_t *)((char *)mapping + header->values_offset);
+    columns->types = (uint8_t *)((char *)mapping + header->types_offset);
+    columns->sectors = (uint8_t *)((char *)mapping + header->sectors_offset);
+    columns->timestamps = header->version >= 2 ? (uint32_t *)((char *)mapping + header->timestamps_offset) : NULL;
+    columns->count = header->count;
+    columns->mapping = mapping;
+    columns->mapping_size = st.st_size;
+    columns->pages = PAGES_DEFAULT;
+
+    if (verify && dataset_checksum(columns) != header->checksum) {
+        printf("Error: dataset checksum mismatch in '%s'\n", path);
+        free_columns(columns);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Compressed archive format (little-endian, version 1)
+ *
+ * A 64-byte ArchiveHeader, then the blocks back to back, then a directory
+ * of num_blocks + 1 uint64_t byte offsets (block b spans directory[b] to
+ * directory[b + 1]). Each block holds up to ARCHIVE_BLOCK readings: a
+ * 32-byte ArchiveBlockHeader with the block's value min/max, followed by
+ * four sections:
+ *
+ *   values      frame of reference: value - value_min, bit-packed at
+ *               value_bits (the width of value_max - value_min)
+ *   types       ENCODING_RLE: uint32_t run count, then {uint16_t length,
+ *   sectors     uint8_t code, uint8_t 0} per run; or ENCODING_DICT:
+ *               uint16_t entry count, the entries as bytes padded to 8,
+ *               then the dictionary indices bit-packed; whichever is smaller
+ *   timestamps  zigzag deltas from the previous reading (the first from
+ *               timestamp_base), bit-packed at timestamp_bits
+ *
+ * Bit-packed sections are followed by 8 zero bytes so a decoder can
+ * always load a whole 64-bit word.
+ */
+#define ARCHIVE_MAGIC "AGSARCHV"
+#define ARCHIVE_VERSION 1
+#define ARCHIVE_BLOCK 16384
+#define ARCHIVE_HAS_TIMESTAMPS 1
+#define ENCODING_RLE 0
+#define ENCODING_DICT 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_readings;
+    uint64_t count;
+    uint64_t num_blocks;
+    uint64_t directory_offset;
+    uint64_t checksum;          // of the block bytes, in order
+    uint32_t flags;
+    uint32_t reserved[3];
+} ArchiveHeader;
+
+typedef struct {
+    uint32_t count;
+    uint16_t value_min;
+    uint16_t value_max;
+    uint8_t value_bits;
+    uint8_t timestamp_bits;
+    uint8_t type_encoding;
+    uint8_t sector_encoding;
+    uint32_t timestamp_base;
+    uint32_t value_bytes;
+    uint32_t type_bytes;
+    uint32_t sector_bytes;
+    uint32_t timestamp_bytes;
+} ArchiveBlockHeader;
+
+_Static_assert(sizeof(ArchiveHeader) == 64, "archive header layout");
+_Static_assert(sizeof(ArchiveBlockHeader) == 32, "archive block header layout");
+_Static_assert(ARCHIVE_BLOCK <= UINT16_MAX, "run lengths are stored as uint16_t");
+
+// Worst-case encoded size of one block, before it is trimmed
+#define ARCHIVE_BLOCK_BOUND (sizeof(ArchiveBlockHeader) + 4 * (4 * ARCHIVE_BLOCK + 288) + 8)
+
+// Function to get the number of bits needed to hold 'value'
+static inline int bit_width(uint32_t value) {
+    return value == 0 ? 0 : 32 - __builtin_clz(value);
+}
+
+// Function to bit-pack 'count' codes of 'bits' bits each; returns the
+// section size including the trailing 8 zero bytes
+static size_t pack_bits(uint8_t *out, const uint32_t *codes, int count, int bits) {
+    size_t bytes = ((size_t)count * bits + 7) / 8;
+    memset(out, 0, bytes + 8);
+    if (bits == 0) {
+        return 8;
+    }
+    for (int i = 0; i < count; i++) {
+        size_t position = (size_t)i * bits;
+        uint64_t word;
+        memcpy(&word, out + (position >> 3), 8);
+        word |= (uint64_t)codes[i] << (position & 7);
+        memcpy(out + (position >> 3), &word, 8);
+    }
+    return bytes + 8;
+}
+
+// Function to read code 'i' of a bit-packed section
+static inline uint32_t unpack_bits(const uint8_t *in, long long i, int bits, uint64_t mask) {
+    size_t position = (size_t)i * bits;
+    uint64_t word;
+    memcpy(&word, in + (position >> 3), 8);
+    return (uint32_t)((word >> (position & 7)) & mask);
+}
+
+// Function to encode a small-code column (types or sectors) as runs or as
+// a packed dictionary, whichever is smaller
+static size_t encode_codes(uint8_t *out, const uint8_t *codes, int count, uint32_t *scratch, uint8_t *encoding) {
+    int runs = 0;
+    int distinct = 0;
+    int slot_of[256];
+    uint8_t dictionary[256];
+    memset(slot_of, -1, sizeof(slot_of));
+
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || codes[i] != codes[i - 1]) {
+            scratch[runs++] = 0;
+        }
+        scratch[runs - 1]++;
+        if (slot_of[codes[i]] < 0) {
+            slot_of[codes[i]] = distinct;
+            dictionary[distinct++] = codes[i];
+        }
+    }
+
+    int index_bits = bit_width(distinct > 0 ? distinct - 1 : 0);
+    size_t dictionary_header = (2 + distinct + 7) / 8 * 8;
+    size_t dict_bytes = dictionary_header + ((size_t)count * index_bits + 7) / 8 + 8;
+    size_t rle_bytes = 4 + 4 * (size_t)runs;
+
+    if (rle_bytes <= dict_bytes) {
+        *encoding = ENCODING_RLE;
+        uint32_t num_runs = runs;
+        memcpy(out, &num_runs, 4);
+        for (int r = 0, i = 0; r < runs; i += scratch[r], r++) {
+            uint16_t length = (uint16_t)scratch[r];
+            memcpy(out + 4 + 4 * r, &length, 2);
+            out[4 + 4 * r + 2] = codes[i];
+            out[4 + 4 * r + 3] = 0;
+        }
+        return rle_bytes;
+    }
+
+    *encoding = ENCODING_DICT;
+    uint16_t entries = distinct;
+    memset(out, 0, dictionary_header);
+    memcpy(out, &entries, 2);
+    memcpy(out + 2, dictionary, distinct);
+    for (int i = 0; i < count; i++) {
+        scratch[i] = slot_of[codes[i]];
+    }
+    return dictionary_header + pack_bits(out + dictionary_header, scratch, count, index_bits);
+}
+
+// Function to decode a small-code column; returns -1 if it is malformed
+static int decode_codes(const uint8_t *in, size_t length, uint8_t encoding, int count, uint8_t *codes) {
+    if (encoding == ENCODING_RLE) {
+        uint32_t runs;
+        if (length < 4) {
+            return -1;
+        }
+        memcpy(&runs, in, 4);
+        if (runs > (length - 4) / 4) {
+            return -1;
+        }
+        int filled = 0;
+        for (uint32_t r = 0; r < runs; r++) {
+            uint16_t run_length;
+            memcpy(&run_length, in + 4 + 4 * r, 2);
+            if (run_length > count - filled) {
+                return -1;
+            }
+            memset(codes + filled, in[4 + 4 * r + 2], run_length);
+            filled += run_length;
+        }
+        return filled == count ? 0 : -1;
+    }
+
+    uint16_t entries;
+    if (encoding != ENCODING_DICT || length < 2) {
+        return -1;
+    }
+    memcpy(&entries, in, 2);
+    size_t dictionary_header = (2 + (size_t)entries + 7) / 8 * 8;
+    int index_bits = bit_width(entries > 0 ? entries - 1 : 0);
+    if (entries == 0 || entries > 256 ||
+        dictionary_header + ((size_t)count * index_bits + 7) / 8 + 8 > length) {
+        return -1;
+    }
+    const uint8_t *dictionary = in + 2;
+    const uint8_t *packed = in + dictionary_header;
+    uint64_t mask = (1ULL << index_bits) - 1;
+    for (int i = 0; i < count; i++) {
+        uint32_t slot = unpack_bits(packed, i, index_bits, mask);
+        if (slot >= entries) {
+            return -1;
+        }
+        codes[i] = dictionary[slot];
+    }
+    return 0;
+}
+
+// Function to encode readings [first, first + count) of 'columns' as one
+// block; 'scratch' holds ARCHIVE_BLOCK codes. Returns the block size.
+size_t encode_block(uint8_t *out, const SensorColumns *columns, long long first, int count, uint32_t *scratch) {
+    ArchiveBlockHeader header;
+    memset(&header, 0, sizeof(header));
+    header.count = count;
+
+    const uint16_t *values = columns->values + first;
+    uint16_t low = values[0], high = values[0];
+    for (int i = 1; i < count; i++) {
+        low = values[i] < low ? values[i] : low;
+        high = values[i] > high ? values[i] : high;
+    }
+    header.value_min = low;
+    header.value_max = high;
+    header.value_bits = bit_width(high - low);
+
+    uint8_t *cursor = out + sizeof(header);
+    for (int i = 0; i < count; i++) {
+        scratch[i] = values[i] - low;
+    }
+    header.value_bytes = pack_bits(cursor, scratch, count, header.value_bits);
+    cursor += header.value_bytes;
+
+    header.type_bytes = encode_codes(cursor, columns->types + first, count, scratch, &header.type_encoding);
+    cursor += header.type_bytes;
+    header.sector_bytes = encode_codes(cursor, columns->sectors + first, count, scratch, &header.sector_encoding);
+    cursor += header.sector_bytes;
+
+    if (columns->timestamps != NULL) {
+        const uint32_t *timestamps = columns->timestamps + first;
+        uint32_t widest = 0;
+        header.timestamp_base = timestamps[0];
+        for (int i = 0; i < count; i++) {
+            int64_t delta = (int64_t)timestamps[i] - (i > 0 ? timestamps[i - 1] : timestamps[0]);
+            scratch[i] = (uint32_t)((delta << 1) ^ (delta >> 63));     // zigzag
+            widest |= scratch[i];
+        }
+        header.timestamp_bits = bit_width(widest);
+        header.timestamp_bytes = pack_bits(cursor, scratch, count, header.timestamp_bits);
+        cursor += header.timestamp_bytes;
+    }
+
+    // Whole 64-bit words per block keep the running checksum independent
+    // of how the blocks are split
+    size_t size = (cursor - out + 7) / 8 * 8;
+    memset(cursor, 0, size - (cursor - out));
+    memcpy(out, &header, sizeof(header));
+    return size;
+}
+
+// Function to decode one block into 'out' (capacity ARCHIVE_BLOCK). The
+// timestamp column is only decoded when 'out' has one and the block holds
+// timestamps. Returns -1 if the block is malformed.
+int decode_block(const uint8_t *block, size_t length, SensorColumns *out) {
+    ArchiveBlockHeader header;
+    if (length < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, block, sizeof(header));
+    int count = header.count;
+    if (count < 1 || count > ARCHIVE_BLOCK || header.value_bits > 16 || header.timestamp_bits > 32 ||
+        (uint64_t)header.value_bytes + header.type_bytes + header.sector_bytes + header.timestamp_bytes >
+            length - sizeof(header) ||
+        header.value_bytes < ((size_t)count * header.value_bits + 7) / 8 + 8 ||
+        (header.timestamp_bytes > 0 &&
+         header.timestamp_bytes < ((size_t)count * header.timestamp_bits + 7) / 8 + 8)) {
+        return -1;
+    }
+
+    const uint8_t *cursor = block + sizeof(header);
+    uint64_t mask = (1ULL << header.value_bits) - 1;
+    for (int i = 0; i < count; i++) {
+        out->values[i] = header.value_min + unpack_bits(cursor, i, header.value_bits, mask);
+    }
+    cursor += header.value_bytes;
+
+    if (decode_codes(cursor, header.type_bytes, header.type_encoding, count, out->types) != 0) {
+        return -1;
+    }
+    cursor += header.type_bytes;
+    if (decode_codes(cursor, header.sector_bytes, header.sector_encoding, count, out->sectors) != 0) {
+        return -1;
+    }
+    cursor += header.sector_bytes;
+
+    if (out->timestamps != NULL && header.timestamp_bytes > 0) {
+        uint64_t ts_mask = header.timestamp_bits == 32 ? UINT32_MAX : (1ULL << header.timestamp_bits) - 1;
+        uint32_t timestamp = header.timestamp_base;
+        for (int i = 0; i < count; i++) {
+            uint32_t zigzag = unpack_bits(cursor, i, header.timestamp_bits, ts_mask);
+            timestamp += (uint32_t)((zigzag >> 1) ^ -(zigzag & 1));
+            out->timestamps[i] = timestamp;
+        }
+    }
+    out->count = count;
+    return 0;
+}
+
+#define ARCHIVE_WINDOW_BLOCKS 4096    // blocks encoded in memory before they are written
+
+typedef struct {
+    const SensorColumns *columns;
+    long long first_block;      // window item b is block first_block + b
+    uint8_t **blocks;           // [ARCHIVE_WINDOW_BLOCKS]
+    size_t *sizes;
+    int failed;
+} ArchiveEncodeJob;
+
+// Pool task to encode window items [begin, end) into their own buffers.
+// Each block is decoded again right away and compared with its source; a
+// mismatch fails the write, and write_archive removes the partial file.
+void encode_blocks(void *ctx, int worker_id, long long begin, long long end) {
+    ArchiveEncodeJob *job = (ArchiveEncodeJob *)ctx;
+    const SensorColumns *columns = job->columns;
+    uint32_t *scratch = (uint32_t *)malloc(ARCHIVE_BLOCK * sizeof(uint32_t));
+    SensorColumns check;
+    int have_check = allocate_columns(&check, ARCHIVE_BLOCK) == 0;
+    (void)worker_id;
+
+    for (long long b = begin; b < end && scratch != NULL && have_check; b++) {
+        long long first = (job->first_block + b) * ARCHIVE_BLOCK;
+        int count = columns->count - first < ARCHIVE_BLOCK ? (int)(columns->count - first) : ARCHIVE_BLOCK;
+        uint8_t *buffer = (uint8_t *)malloc(ARCHIVE_BLOCK_BOUND);
+        if (buffer == NULL) {
+            break;
+        }
+        job->sizes[b] = encode_block(buffer, columns, first, count, scratch);
+        uint8_t *trimmed = (uint8_t *)realloc(buffer, job->sizes[b]);
+        job->blocks[b] = trimmed != NULL ? trimmed : buffer;
+
+        if (decode_block(job->blocks[b], job->sizes[b], &check) != 0 || check.count != count ||
+            memcmp(check.values, columns->values + first, count * sizeof(uint16_t)) != 0 ||
+            memcmp(check.types, columns->types + first, count) != 0 ||
+            memcmp(check.sectors, columns->sectors + first, count) != 0 ||
+            (columns->timestamps != NULL &&
+             memcmp(check.timestamps, columns->timestamps + first, count * sizeof(uint32_t)) != 0)) {
+            __atomic_store_n(&job->failed, 2, __ATOMIC_RELAXED);
+        }
+    }
+    for (long long b = begin; b < end; b++) {
+        if (job->blocks[b] == NULL) {
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+        }
+    }
+    if (have_check) {
+        free_columns(&check);
+    }
+    free(scratch);
+}
+
+// Function to compress 'columns' into an archive file. Blocks are encoded
+// in parallel a window at a time and written in order, so memory use does
+// not grow with the dataset. They go to 'path'.tmp, which is renamed to
+// 'path' only once the whole archive is out, and removed on any error.
+int write_archive(ThreadPool *pool, int active, long long chunk_size, const SensorColumns *columns,
+                  const char *path) {
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, 8);
+    header.version = ARCHIVE_VERSION;
+    header.block_readings = ARCHIVE_BLOCK;
+    header.count = columns->count;
+    header.num_blocks = (columns->count + ARCHIVE_BLOCK - 1) / ARCHIVE_BLOCK;
+    header.flags = columns->timestamps != NULL ? ARCHIVE_HAS_TIMESTAMPS : 0;
+    header.checksum = 0xcbf29ce484222325ULL;
+
+    long long num_blocks = header.num_blocks;
+    ArchiveEncodeJob job = {columns, 0, calloc(ARCHIVE_WINDOW_BLOCKS, sizeof(uint8_t *)),
+                            calloc(ARCHIVE_WINDOW_BLOCKS, sizeof(size_t)), 0};
+    uint64_t *directory = (uint64_t *)malloc((num_blocks + 1) * sizeof(uint64_t));
+    char *temp_path = (char *)malloc(strlen(path) + 5);
+    int status = -1;
+    FILE *file = NULL;
+
+    if (job.blocks == NULL || job.sizes == NULL || directory == NULL || temp_path == NULL) {
+        printf("Memory allocation failed\n");
+        goto done;
+    }
+    sprintf(temp_path, "%s.tmp", path);
+    file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        perror("Failed to create archive file");
+        goto done;
+    }
+
+    // The header is rewritten with the final checksum once every block is out
+    uint64_t offset = sizeof(header);
+    status = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+    long long blocks_per_chunk = chunk_size / ARCHIVE_BLOCK > 0 ? chunk_size / ARCHIVE_BLOCK : 1;
+    for (job.first_block = 0; job.first_block < num_blocks && status == 0; job.first_block += ARCHIVE_WINDOW_BLOCKS) {
+        long long window = num_blocks - job.first_block < ARCHIVE_WINDOW_BLOCKS
+                           ? num_blocks - job.first_block : ARCHIVE_WINDOW_BLOCKS;
+        pool_run(pool, active, window, blocks_per_chunk, encode_blocks, NULL, &job);
+        if (job.failed) {
+            printf(job.failed == 2 ? "Error: archive round-trip check failed\n" : "Memory allocation failed\n");
+            fclose(file);
+            unlink(temp_path);
+            status = -1;
+            goto done;
+        }
+        for (long long b = 0; b < window; b++) {
+            directory[job.first_block + b] = offset;
+            offset += job.sizes[b];
+            header.checksum = checksum_update(header.checksum, job.blocks[b], job.sizes[b]);
+            if (status == 0 && fwrite(job.blocks[b], 1, job.sizes[b], file) != job.sizes[b]) {
+                status = -1;
+            }
+            free(job.blocks[b]);
+            job.blocks[b] = NULL;
+        }
+    }
+    directory[num_blocks] = offset;
+    header.directory_offset = offset;
+
+    if (status == 0 && fwrite(directory, sizeof(uint64_t), num_blocks + 1, file) != (size_t)num_blocks + 1) {
+        status = -1;
+    }
+    if (status == 0 && (fseek(file, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, file) != 1)) {
+        status = -1;
+    }
+    if (fclose(file) != 0 || status != 0 || rename(temp_path, path) != 0) {
+        perror("Failed to write archive file");
+        unlink(temp_path);
+        status = -1;
+        goto done;
+    }
+
+    uint64_t file_size = offset + (num_blocks + 1) * sizeof(uint64_t);
+    printf("Archive written: %llu bytes, %.2f bytes per reading (%.1fx smaller than the column format)\n",
+           (unsigned long long)file_size, (double)file_size / columns->count,
+           8.0 * columns->count / file_size);
+
+done:
+    for (long long b = 0; job.blocks != NULL && b < ARCHIVE_WINDOW_BLOCKS; b++) {
+        free(job.blocks[b]);
+    }
+    free(job.blocks);
+    free(job.sizes);
+    free(directory);
+    free(temp_path);
+    return status;
+}
+
+// A mapped archive file
+typedef struct {
+    void *mapping;
+    size_t mapping_size;
+    const ArchiveHeader *header;
+    const uint64_t *directory;
+} MappedArchive;
+
+// Function to map an archive and check its header and block directory.
+// With 'verify' set, the checksum of the block bytes is checked too.
+int map_archive(const char *path, MappedArchive *archive, int verify) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Failed to open archive file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(ArchiveHeader)) {
+        printf("Error: '%s' is too small to be a sensor archive\n", path);
+        close(fd);
+        return -1;
+    }
+    void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        perror("Failed to map archive file");
+        return -1;
+    }
+    madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+
+    const ArchiveHeader *header = (const ArchiveHeader *)mapping;
+    uint64_t size = st.st_size;
+    int valid = memcmp(header->magic, ARCHIVE_MAGIC, 8) == 0 && header->version == ARCHIVE_VERSION &&
+                header->block_readings == ARCHIVE_BLOCK &&
+                header->num_blocks == (header->count + ARCHIVE_BLOCK - 1) / ARCHIVE_BLOCK &&
+                header->directory_offset >= sizeof(ArchiveHeader) && header->directory_offset <= size &&
+                header->num_blocks < (size - header->directory_offset) / sizeof(uint64_t);
+    const uint64_t *directory = (const uint64_t *)((const char *)mapping + header->directory_offset);
+    for (uint64_t b = 0; valid && b < header->num_blocks; b++) {
+        valid = directory[b] >= sizeof(ArchiveHeader) && directory[b] < directory[b + 1] &&
+                directory[b + 1] <= header->directory_offset;
+    }
+    if (!valid) {
+        printf("Error: '%s' is not a valid sensor archive (bad header or truncated)\n", path);
+        munmap(mapping, st.st_size);
+        return -1;
+    }
+    if (verify && header->num_blocks > 0) {
+        uint64_t checksum = checksum_update(0xcbf29ce484222325ULL, (const char *)mapping + directory[0],
+                                            header->directory_offset - directory[0]);
+        if (checksum != header->checksum) {
+            printf("Error: archive checksum mismatch in '%s'\n", path);
+            munmap(mapping, st.st_size);
+            return -1;
+        }
+    }
+
+    archive->mapping = mapping;
+    archive->mapping_size = st.st_size;
+    archive->header = header;
+    archive->directory = directory;
+    return 0;
+}
+
+// Function to get sensor type name
+const char* get_sensor_type_name(SensorType type) {
+    switch (type) {
+        case SOIL_MOISTURE: return "Soil Moisture";
+        case TEMPERATURE: return "Temperature";
+        case HUMIDITY: return "Humidity";
+        case LIGHT_INTENSITY: return "Light Intensity";
+        case NUTRIENT_LEVEL: return "Nutrient Level";
+        default: return "Unknown";
+    }
+}
+
+// Function to read a monotonic wall-clock time in seconds
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Function to pick the worker count: SENSOR_THREADS if set, else online cores
+int detect_thread_count() {
+    const char *env = getenv("SENSOR_THREADS");
+    if (env != NULL && atoi(env) > 0) {
+        int threads = atoi(env);
+        return threads > MAX_THREADS ? MAX_THREADS : threads;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) {
+        cores = 1;
+    }
+    return cores > MAX_THREADS ? MAX_THREADS : (int)cores;
+}
+
+// Function to take the next chunk from a worker's own queue
+static int pool_pop(WorkQueue *queue, long long *chunk) {
+    int found = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->next < queue->end) {
+        *chunk = queue->next++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return found;
+}
+
+// Function to move the back half of a victim's remaining chunks to the thief
+static int pool_steal(ThreadPool *pool, int thief) {
+    for (int k = 1; k < pool->active_workers; k++) {
+        int victim = (thief + k) % pool->active_workers;
+        WorkQueue *vq = &pool->queues[victim];
+        long long begin = 0, end = 0;
+
+        pthread_mutex_lock(&vq->lock);
+        long long remaining = vq->end - vq->next;
+        if (remaining > 0) {
+            end = vq->end;
+            begin = end - (remaining + 1) / 2;
+            vq->end = begin;
+        }
+        pthread_mutex_unlock(&vq->lock);
+
+        if (end > begin) {
+            WorkQueue *own = &pool->queues[thief];
+            pthread_mutex_lock(&own->lock);
+            own->next = begin;
+            own->end = end;
+            pthread_mutex_unlock(&own->lock);
+            pool->workers[thief].chunks_stolen += end - begin;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Worker loop: wait for a job, drain own queue, steal until no work is left
+static void *pool_worker_main(void *arg) {
+    PoolWorker *worker = (PoolWorker *)arg;
+    ThreadPool *pool = worker->pool;
+    unsigned long seen_generation = 0;
+    __atomic_store_n(&worker->tid, (pid_t)syscall(SYS_gettid), __ATOMIC_RELEASE);
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen_generation = pool->generation;
+        int participating = worker->id < pool->active_workers;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!participating) {
+            continue;
+        }
+
+        long long chunk;
+        for (;;) {
+            while (pool_pop(&pool->queues[worker->id], &chunk)) {
+                long long begin = chunk * pool->chunk_size;
+                long long end = begin + pool->chunk_size;
+                if (end > pool->total_items) {
+                    end = pool->total_items;
+                }
+                pool->task(pool->ctx, worker->id, begin, end);
+            }
+            if (!pool->stealing || !pool_steal(pool, worker->id)) {
+                break;
+            }
+        }
+
+        if (pool->done != NULL) {
+            pool->done(pool->ctx, worker->id);
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) {
+            pthread_cond_signal(&pool->work_done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+// Function to create the pool and start its worker threads
+ThreadPool *pool_create(int num_workers) {
+    ThreadPool *pool = (ThreadPool *)calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+
+    pool->num_workers = num_workers;
+    pool->threads = (pthread_t *)calloc(num_workers, sizeof(pthread_t));
+    pool->workers = (PoolWorker *)aligned_alloc(CACHE_LINE_SIZE, num_workers * sizeof(PoolWorker));
+    pool->queues = (WorkQueue *)aligned_alloc(CACHE_LINE_SIZE, num_workers * sizeof(WorkQueue));
+    if (pool->threads == NULL || pool->workers == NULL || pool->queues == NULL) {
+        free(pool->threads);
+        free(pool->workers);
+        free(pool->queues);
+        free(pool);
+        return NULL;
+    }
+    memset(pool->workers, 0, num_workers * sizeof(PoolWorker));
+    memset(pool->queues, 0, num_workers * sizeof(WorkQueue));
+    pool->stealing = 1;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (int i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pool->workers[i].cpu = -1;
+        if (pthread_create(&pool->threads[i], NULL, pool_worker_main, &pool->workers[i]) != 0) {
+            perror("Failed to create thread");
+            pool->num_workers = i;
+            pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+// Function to compute the contiguous chunks [first, last) initially dealt
+// to 'worker'. The deal only depends on the chunk and worker counts, so a
+// job with the same shape always gives a worker the same range.
+void worker_chunk_range(long long num_chunks, int active, int worker, long long *first, long long *last) {
+    long long per_worker = num_chunks / active;
+    long long remaining = num_chunks % active;
+    *first = worker * per_worker + (worker < remaining ? worker : remaining);
+    *last = *first + per_worker + (worker < remaining ? 1 : 0);
+}
+
+// Function to run a job on the first 'active' workers and wait for it to finish
+void pool_run(ThreadPool *pool, int active, long long total_items, long long chunk_size,
+              PoolTask task, PoolDone done, void *ctx) {
+    if (active < 1 || active > pool->num_workers) {
+        active = pool->num_workers;
+    }
+
+    // Deal the chunks out evenly; stealing rebalances whatever is uneven
+    long long num_chunks = (total_items + chunk_size - 1) / chunk_size;
+    for (int i = 0; i < active; i++) {
+        worker_chunk_range(num_chunks, active, i, &pool->queues[i].next, &pool->queues[i].end);
+        pool->workers[i].chunks_stolen = 0;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active_workers = active;
+    pool->total_items = total_items;
+    pool->chunk_size = chunk_size;
+    pool->task = task;
+    pool->done = done;
+    pool->ctx = ctx;
+    pool->running = active;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// Function to stop the worker threads and release the pool
+void pool_destroy(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_cond_destroy(&pool->work_done);
+
+    free(pool->threads);
+    free(pool->workers);
+    free(pool->queues);
+    free(pool);
+}
+
+// Function to find the NUMA node of a CPU from sysfs (0 when unknown)
+int cpu_numa_node(int cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    int node = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "node", 4) == 0 && isdigit((unsigned char)entry->d_name[4])) {
+            node = atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// Function to pin worker i to the i-th CPU this process may run on
+// (wrapping around when there are more workers than CPUs)
+int pool_pin_workers(ThreadPool *pool) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        perror("Failed to read CPU affinity");
+        return -1;
+    }
+
+    int cpus[CPU_SETSIZE];
+    int num_cpus = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            cpus[num_cpus++] = cpu;
+        }
+    }
+    if (num_cpus == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < pool->num_workers; i++) {
+        int cpu = cpus[i % num_cpus];
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (pthread_setaffinity_np(pool->threads[i], sizeof(set), &set) != 0) {
+            printf("Error: failed to pin thread %d to CPU %d\n", i, cpu);
+            return -1;
+        }
+        pool->workers[i].cpu = cpu;
+        pool->workers[i].node = cpu_numa_node(cpu);
+    }
+    return 0;
+}
+
+// qsort comparator for doubles in ascending order
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Function to recompute the compactor capacities: K at the top level,
+// shrinking by 2/3 per level below it, never under KLL_MIN_CAPACITY items
+static void kll_update_capacities(KllSketch *kll) {
+    double capacity = KLL_K;
+    for (int h = kll->num_levels - 1; h >= 0; h--) {
+        kll->capacities[h] = capacity < KLL_MIN_CAPACITY ? KLL_MIN_CAPACITY : (int)capacity;
+        capacity *= 2.0 / 3.0;
+    }
+}
+
+// Function to initialise an empty KLL sketch
+void kll_init(KllSketch *kll, uint64_t seed) {
+    memset(kll, 0, sizeof(*kll));
+    kll->num_levels = 1;
+    kll->random = seed | 1;
+    kll_update_capacities(kll);
+}
+
+// Function to empty a KLL sketch, keeping its buffers for reuse
+void kll_reset(KllSketch *kll) {
+    for (int h = 0; h < kll->num_levels; h++) {
+        kll->sizes[h] = 0;
+    }
+    kll->num_levels = 1;
+    kll->count = 0;
+    kll_update_capacities(kll);
+}
+
+// Function to release a KLL sketch's buffers
+void kll_free(KllSketch *kll) {
+    for (int h = 0; h < KLL_MAX_LEVELS; h++) {
+        free(kll->levels[h]);
+    }
+    memset(kll, 0, sizeof(*kll));
+}
+
+// Function to append one item to a level, growing its buffer if needed
+static int kll_append(KllSketch *kll, int level, double item) {
+    if (kll->sizes[level] == kll->allocated[level]) {
+        int allocated = kll->allocated[level] < 8 ? 8 : kll->allocated[level] * 2;
+        double *grown = (double *)realloc(kll->levels[level], allocated * sizeof(double));
+        if (grown == NULL) {
+            return -1;
+        }
+        kll->levels[level] = grown;
+        kll->allocated[level] = allocated;
+    }
+    kll->levels[level][kll->sizes[level]++] = item;
+    return 0;
+}
+
+// Function to sort a compactor's items: insertion sort for the small
+// lower levels, which are compacted most often, qsort for the rest
+static void kll_sort(double *items, int count) {
+    if (count > 32) {
+        qsort(items, count, sizeof(double), compare_doubles);
+        return;
+    }
+    for (int i = 1; i < count; i++) {
+        double item = items[i];
+        int j = i - 1;
+        while (j >= 0 && items[j] > item) {
+            items[j + 1] = items[j];
+            j--;
+        }
+        items[j + 1] = item;
+    }
+}
+
+// Function to compact every level that has reached its capacity, from the
+// bottom up. Sorting a level and keeping every other item (starting at a
+// random parity) halves it while doubling the weight of the survivors.
+// On an odd level, the item left out is the smallest or the largest at
+// random, so the leftovers do not skew the sketch either way.
+// If memory runs out, the level is left uncompacted (and over capacity)
+// rather than half promoted, so every item keeps its weight.
+static void kll_compress(KllSketch *kll) {
+    for (int h = 0; h < kll->num_levels; h++) {
+        if (kll->sizes[h] < kll->capacities[h]) {
+            continue;
+        }
+        if (h + 1 == kll->num_levels) {
+            if (kll->num_levels == KLL_MAX_LEVELS) {
+                return;
+            }
+            kll->num_levels++;
+            kll_update_capacities(kll);
+        }
+
+        double *items = kll->levels[h];
+        int pairs = kll->sizes[h] & ~1;
+        kll_sort(items, kll->sizes[h]);
+
+        kll->random ^= kll->random << 13;
+        kll->random ^= kll->random >> 7;
+        kll->random ^= kll->random << 17;
+        int first = kll->sizes[h] > pairs ? (int)(kll->random >> 1 & 1) : 0;
+        int offset = (int)(kll->random & 1);
+        int promoted_from = kll->sizes[h + 1];
+        for (int i = first + offset; i < first + pairs; i += 2) {
+            if (kll_append(kll, h + 1, items[i]) != 0) {
+                kll->sizes[h + 1] = promoted_from;
+                return;
+            }
+        }
+
+        // An odd item out stays behind at its current weight
+        if (kll->sizes[h] > pairs && first == 0) {
+            items[0] = items[pairs];
+        }
+        kll->sizes[h] -= pairs;
+    }
+}
+
+// Function to add one value to a KLL sketch. Returns -1 if memory runs
+// out; a value that could not be stored is not counted.
+static inline int kll_add(KllSketch *kll, double value) {
+    if (kll_append(kll, 0, value) != 0) {
+        return -1;
+    }
+    if (kll->count == 0 || value < kll->min) {
+        kll->min = value;
+    }
+    if (kll->count == 0 || value > kll->max) {
+        kll->max = value;
+    }
+    kll->count++;
+    if (kll->sizes[0] >= kll->capacities[0]) {
+        kll_compress(kll);
+    }
+    return 0;
+}
+
+// Function to merge one KLL sketch into another: levels of equal weight
+// are concatenated and then compacted back under their capacities.
+// Returns -1 if memory runs out; 'into' then holds none of 'from'.
+int kll_merge(KllSketch *into, const KllSketch *from) {
+    if (from->count == 0) {
+        return 0;
+    }
+    int sizes[KLL_MAX_LEVELS];
+    memcpy(sizes, into->sizes, sizeof(sizes));
+    for (int h = 0; h < from->num_levels; h++) {
+        for (int i = 0; i < from->sizes[h]; i++) {
+            if (kll_append(into, h, from->levels[h][i]) != 0) {
+                memcpy(into->sizes, sizes, sizeof(sizes));
+                return -1;
+            }
+        }
+    }
+    if (into->count == 0 || from->min < into->min) {
+        into->min = from->min;
+    }
+    if (into->count == 0 || from->max > into->max) {
+        into->max = from->max;
+    }
+    if (from->num_levels > into->num_levels) {
+        into->num_levels = from->num_levels;
+        kll_update_capacities(into);
+    }
+    into->count += from->count;
+    kll_compress(into);
+    return 0;
+}
+
+typedef struct {
+    double value;
+    double weight;
+} WeightedItem;
+
+static int compare_weighted_items(const void *a, const void *b) {
+    double x = ((const WeightedItem *)a)->value;
+    double y = ((const WeightedItem *)b)->value;
+    return (x > y) - (x < y);
+}
+
+// Function to estimate the q-quantile (0..1) of a KLL sketch: sort the
+// retained items by value and walk their weights to the target rank
+double kll_quantile(const KllSketch *kll, double q) {
+    if (kll->count == 0) {
+        return 0;
+    }
+    int retained = 0;
+    for (int h = 0; h < kll->num_levels; h++) {
+        retained += kll->sizes[h];
+    }
+    WeightedItem *items = (WeightedItem *)malloc(retained * sizeof(WeightedItem));
+    if (items == NULL) {
+        return 0;
+    }
+
+    int k = 0;
+    double total = 0;
+    for (int h = 0; h < kll->num_levels; h++) {
+        for (int i = 0; i < kll->sizes[h]; i++) {
+            items[k].value = kll->levels[h][i];
+            items[k].weight = (double)(1ULL << h);
+            total += items[k++].weight;
+        }
+    }
+    qsort(items, retained, sizeof(WeightedItem), compare_weighted_items);
+
+    double target = q * total;
+    double cumulative = 0;
+    double result = kll->max;
+    for (int i = 0; i < retained; i++) {
+        cumulative += items[i].weight;
+        if (cumulative >= target) {
+            result = items[i].value;
+            break;
+        }
+    }
+    free(items);
+    return result;
+}
+
+// Function to allocate an empty set of sketches of the given kind
+DistributionSketch *sketch_create(SketchKind kind) {
+    DistributionSketch *sketch = (DistributionSketch *)calloc(1, sizeof(DistributionSketch));
+    if (sketch == NULL) {
+        return NULL;
+    }
+    sketch->kind = kind;
+    if (kind == SKETCH_HISTOGRAM) {
+        sketch->bins = calloc(NUM_GROUPS, sizeof(*sketch->bins));
+    } else {
+        sketch->kll = (KllSketch *)calloc(NUM_GROUPS, sizeof(KllSketch));
+        for (int g = 0; sketch->kll != NULL && g < NUM_GROUPS; g++) {
+            kll_init(&sketch->kll[g], 0x9e3779b97f4a7c15ULL * (g + 1));
+        }
+    }
+    if (sketch->bins == NULL && sketch->kll == NULL) {
+        free(sketch);
+        return NULL;
+    }
+    return sketch;
+}
+
+// Function to empty a set of sketches for the next pass
+void sketch_reset(DistributionSketch *sketch) {
+    sketch->failed = 0;
+    if (sketch->kind == SKETCH_HISTOGRAM) {
+        memset(sketch->bins, 0, NUM_GROUPS * sizeof(*sketch->bins));
+    } else {
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            kll_reset(&sketch->kll[g]);
+        }
+    }
+}
+
+// Function to release a set of sketches
+void sketch_free(DistributionSketch *sketch) {
+    if (sketch == NULL) {
+        return;
+    }
+    if (sketch->kll != NULL) {
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            kll_free(&sketch->kll[g]);
+        }
+    }
+    free(sketch->bins);
+    free(sketch->kll);
+    free(sketch);
+}
+
+// Function to feed readings [begin, end) of 'columns' into the sketches.
+// Once a KLL sketch runs out of memory the set is marked failed and fed
+// no more; its percentiles would no longer cover every reading.
+void sketch_add_range(DistributionSketch *sketch, const SensorColumns *columns, long long begin, long long end) {
+    for (long long i = begin; i < end && !sketch->failed; i++) {
+        int type = columns->types[i];
+        int sector = columns->sectors[i];
+        int value = columns->values[i];
+        if (type >= NUM_SENSOR_TYPES || sector < 1 || sector > NUM_SECTORS || value > MAX_SENSOR_VALUE) {
+            continue;
+        }
+        int group = type * NUM_SECTORS + (sector - 1);
+        if (sketch->kind == SKETCH_HISTOGRAM) {
+            sketch->bins[group][value]++;
+        } else if (kll_add(&sketch->kll[group], value) != 0) {
+            sketch->failed = 1;
+        }
+    }
+}
+
+// Function to merge one set of sketches into another of the same kind
+void sketch_merge(DistributionSketch *into, const DistributionSketch *from) {
+    into->failed |= from->failed;
+    for (int g = 0; g < NUM_GROUPS && !into->failed; g++) {
+        if (into->kind == SKETCH_HISTOGRAM) {
+            for (int v = 0; v <= MAX_SENSOR_VALUE; v++) {
+                into->bins[g][v] += from->bins[g][v];
+            }
+        } else if (kll_merge(&into->kll[g], &from->kll[g]) != 0) {
+            into->failed = 1;
+        }
+    }
+}
+
+// Summary of one group's distribution
+typedef struct {
+    long long count;
+    double min;
+    double max;
+    double p5;
+    double p50;
+    double p95;
+} Percentiles;
+
+// Function to summarise the distribution of 'type' (-1 for all) in
+// 'sector' (0 for all) by merging the matching group sketches
+Percentiles sketch_percentiles(const DistributionSketch *sketch, int type, int sector) {
+    static const double quantiles[3] = {0.05, 0.50, 0.95};
+    double results[3] = {0, 0, 0};
+    Percentiles summary;
+    memset(&summary, 0, sizeof(summary));
+
+    if (sketch->kind == SKETCH_HISTOGRAM) {
+        uint64_t bins[MAX_SENSOR_VALUE + 1] = {0};
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            if ((type < 0 || type == g / NUM_SECTORS) && (sector == 0 || sector == g % NUM_SECTORS + 1)) {
+                for (int v = 0; v <= MAX_SENSOR_VALUE; v++) {
+                    bins[v] += sketch->bins[g][v];
+                }
+            }
+        }
+        for (int v = 0; v <= MAX_SENSOR_VALUE; v++) {
+            summary.count += bins[v];
+        }
+        if (summary.count == 0) {
+            return summary;
+        }
+
+        // Nearest rank: the smallest value whose cumulative count reaches q * count
+        long long cumulative = 0;
+        int q = 0;
+        summary.min = -1;
+        for (int v = 0; v <= MAX_SENSOR_VALUE; v++) {
+            if (bins[v] == 0) {
+                continue;
+            }
+            if (summary.min < 0) {
+                summary.min = v;
+            }
+            summary.max = v;
+            cumulative += bins[v];
+            while (q < 3 && cumulative >= quantiles[q] * summary.count) {
+                results[q++] = v;
+            }
+        }
+    } else {
+        KllSketch merged;
+        kll_init(&merged, 1);
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            if ((type < 0 || type == g / NUM_SECTORS) && (sector == 0 || sector == g % NUM_SECTORS + 1)) {
+                kll_merge(&merged, &sketch->kll[g]);
+            }
+        }
+        summary.count = merged.count;
+        summary.min = merged.min;
+        summary.max = merged.max;
+        for (int q = 0; q < 3; q++) {
+            results[q] = kll_quantile(&merged, quantiles[q]);
+        }
+        kll_free(&merged);
+    }
+    summary.p5 = results[0];
+    summary.p50 = results[1];
+    summary.p95 = results[2];
+    return summary;
+}
+
+// Function to print one percentile row
+static void print_percentile_row(const char *label, const Percentiles *p) {
+    if (p->count == 0) {
+        return;
+    }
+    printf("%-18s %12lld %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+           label, p->count, p->min, p->p5, p->p50, p->p95, p->max);
+}
+
+// Function to report value distributions per sensor type, and soil
+// moisture per sector, from the merged sketches
+void print_percentile_report(const DistributionSketch *sketch) {
+    printf("\n===== Sensor Value Distribution (%s) =====\n",
+           sketch->kind == SKETCH_HISTOGRAM ? "fixed-bin histograms, exact" : "KLL sketches, approximate");
+    if (sketch->failed) {
+        printf("Error: the sketches ran out of memory and dropped readings; no percentiles reported\n");
+        return;
+    }
+    printf("%-18s %12s %8s %8s %8s %8s %8s\n", "Group", "Count", "Min", "P5", "P50", "P95", "Max");
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        Percentiles p = sketch_percentiles(sketch, t, 0);
+        print_percentile_row(get_sensor_type_name((SensorType)t), &p);
+    }
+
+    printf("\n%s by sector:\n", get_sensor_type_name(SOIL_MOISTURE));
+    for (int s = 1; s <= NUM_SECTORS; s++) {
+        char label[32];
+        snprintf(label, sizeof(label), "Sector %d", s);
+        Percentiles p = sketch_percentiles(sketch, SOIL_MOISTURE, s);
+        print_percentile_row(label, &p);
+    }
+}
+
+// Function to add the counts and sums of 'from' into 'into'
+void merge_group_totals(GroupTotals *into, const GroupTotals *from) {
+    into->sum += from->sum;
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        into->type_counts[t] += from->type_counts[t];
+        into->type_sums[t] += from->type_sums[t];
+    }
+    for (int s = 0; s < NUM_SECTORS; s++) {
+        into->sector_counts[s] += from->sector_counts[s];
+        into->sector_sums[s] += from->sector_sums[s];
+    }
+}
+
+// Pool task to aggregate one chunk of readings into the worker's local
+// totals. 'ctx' is the shared rolling statistics when the pass keeps them;
+// the worker only reads which buckets they still retain.
+void aggregate_chunk(void *ctx, int worker_id, long long begin, long long end) {
+    ThreadData *data = &thread_data[worker_id];
+    const SensorColumns *columns = data->columns;
+    const RollingStats *rolling = (const RollingStats *)ctx;
+    
+    // Record start time
+    double start_time = now_seconds();
+    
+    // One sweep takes the total and fills the type and sector histograms
+    group_kernel(columns->values + begin, columns->types + begin, columns->sectors + begin,
+                 end - begin, &data->totals);
+    if (data->sketch != NULL) {
+        sketch_add_range(data->sketch, columns, begin, end);
+    }
+    if (data->rolling != NULL) {
+        rolling_add_range(data->rolling, columns, begin, end, rolling->newest_bucket - ROLLING_BUCKETS + 1);
+    }
+    data->readings_processed += end - begin;
+    data->chunks_processed++;
+    
+    // Record end time and accumulate processing time
+    data->processing_time += now_seconds() - start_time;
+}
+
+// Called by each worker once the aggregation pass has no chunks left:
+// fold the worker's slot into the shared totals with atomic adds, so no
+// lock is taken and early finishers never wait on stragglers
+void finish_aggregation(void *ctx, int worker_id) {
+    ThreadData *data = &thread_data[worker_id];
+    (void)ctx;
+    
+    data->partial_sum = data->totals.sum;
+    __atomic_fetch_add(&total_sum, data->partial_sum, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&total_groups.sum, data->totals.sum, __ATOMIC_RELAXED);
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        __atomic_fetch_add(&total_groups.type_counts[t], data->totals.type_counts[t], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&total_groups.type_sums[t], data->totals.type_sums[t], __ATOMIC_RELAXED);
+    }
+    for (int s = 0; s < NUM_SECTORS; s++) {
+        __atomic_fetch_add(&total_groups.sector_counts[s], data->totals.sector_counts[s], __ATOMIC_RELAXED);
+        __atomic_fetch_add(&total_groups.sector_sums[s], data->totals.sector_sums[s], __ATOMIC_RELAXED);
+    }
+}
+
+// Function to print what each worker did in the last job (kept out of the
+// timed region; pool_run has already joined the job)
+void print_worker_report(ThreadPool *pool, int active) {
+    for (int i = 0; i < active; i++) {
+        ThreadData *data = &thread_data[i];
+        printf("Thread %d: Processed %lld sensor readings in %lld chunks (%lld stolen) = %lld (%.4f seconds)\n",
+               data->thread_id, data->readings_processed, data->chunks_processed,
+               pool->workers[i].chunks_stolen, data->partial_sum, data->processing_time);
+    }
+}
+
+// Function to clear every worker's result slot and the shared totals
+// before an aggregation pass over 'columns'
+void reset_worker_results(ThreadPool *pool, const SensorColumns *columns) {
+    for (int i = 0; i < pool->num_workers; i++) {
+        thread_data[i].thread_id = i;
+        thread_data[i].columns = columns;
+        thread_data[i].readings_processed = 0;
+        thread_data[i].chunks_processed = 0;
+        thread_data[i].partial_sum = 0;
+        memset(&thread_data[i].totals, 0, sizeof(GroupTotals));
+        thread_data[i].processing_time = 0;
+    }
+    total_sum = 0;
+    memset(&total_groups, 0, sizeof(total_groups));
+}
+
+// Function to give each of the 'active' workers its own percentile sketch
+// and rolling buckets for a pass, and to free those of idle workers. A
+// sink the workers cannot all get memory for is skipped (set to NULL).
+void prepare_worker_sinks(ThreadPool *pool, int active, DistributionSketch **sketch, RollingStats **rolling) {
+    for (int i = 0; i < active; i++) {
+        if (*sketch != NULL) {
+            if (thread_data[i].sketch == NULL || thread_data[i].sketch->kind != (*sketch)->kind) {
+                sketch_free(thread_data[i].sketch);
+                thread_data[i].sketch = sketch_create((*sketch)->kind);
+            } else {
+                sketch_reset(thread_data[i].sketch);
+            }
+            if (thread_data[i].sketch == NULL) {
+                printf("Warning: not enough memory for percentile sketches; skipping them\n");
+                *sketch = NULL;
+            }
+        }
+        if (*rolling != NULL) {
+            if (thread_data[i].rolling == NULL) {
+                thread_data[i].rolling = rolling_create();
+            } else {
+                rolling_reset(thread_data[i].rolling);
+            }
+            if (thread_data[i].rolling == NULL) {
+                printf("Warning: not enough memory for rolling statistics; skipping this batch\n");
+                *rolling = NULL;
+            }
+        }
+    }
+    for (int i = 0; i < pool->num_workers; i++) {
+        if (*sketch == NULL || i >= active) {
+            sketch_free(thread_data[i].sketch);
+            thread_data[i].sketch = NULL;
+        }
+        if (*rolling == NULL || i >= active) {
+            free(thread_data[i].rolling);
+            thread_data[i].rolling = NULL;
+        }
+    }
+}
+
+// Function to merge the workers' sketches and rolling buckets after a pass.
+// They cannot be folded in with atomic adds, so this runs here rather than
+// under a lock in finish_aggregation, which every worker runs at once.
+void merge_worker_sinks(int active, DistributionSketch *sketch, RollingStats *rolling) {
+    if (sketch != NULL) {
+        for (int i = 0; i < active; i++) {
+            sketch_merge(sketch, thread_data[i].sketch);
+        }
+    }
+    if (rolling != NULL) {
+        // Every worker's buckets are judged against the newest reading of the whole pass
+        for (int i = 0; i < active; i++) {
+            if (thread_data[i].rolling->newest_timestamp > rolling->newest_timestamp) {
+                rolling->newest_timestamp = thread_data[i].rolling->newest_timestamp;
+                rolling->newest_bucket = thread_data[i].rolling->newest_bucket;
+            }
+        }
+        for (int i = 0; i < active; i++) {
+            rolling_merge(rolling, thread_data[i].rolling);
+        }
+    }
+}
+
+// Function to run the fused aggregation pass on 'active' workers of the pool.
+// With 'sketch' set, workers also build percentile sketches of their
+// readings, which are merged into 'sketch' once the pass is over. With
+// 'rolling' set (timestamped columns only), workers likewise fold their
+// readings into private rolling buckets that are merged into 'rolling'.
+long long run_parallel_aggregation(ThreadPool *pool, int active, const SensorColumns *columns,
+                                   long long chunk_size, DistributionSketch *sketch, RollingStats *rolling) {
+    prepare_worker_sinks(pool, active, &sketch, &rolling);
+    reset_worker_results(pool, columns);
+    pool_run(pool, active, columns->count, chunk_size, aggregate_chunk, finish_aggregation, rolling);
+    merge_worker_sinks(active, sketch, rolling);
+    return total_sum;
+}
+
+// Function to print wall-clock time of the aggregation pass for 1..N active workers
+void print_scaling_curve(ThreadPool *pool, long long chunk_size) {
+    printf("\n===== Scaling Curve (best of %d runs) =====\n", SCALING_REPETITIONS);
+    printf("%-8s %-12s %-10s %-10s\n", "Threads", "Seconds", "Speedup", "Efficiency");
+    
+    double baseline = 0;
+    for (int threads = 1; threads <= pool->num_workers; threads++) {
+        double best = 0;
+        for (int rep = 0; rep < SCALING_REPETITIONS; rep++) {
+            double start = now_seconds();
+            run_parallel_aggregation(pool, threads, &sensor_data, chunk_size, NULL, NULL);
+            double elapsed = now_seconds() - start;
+            if (rep == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        if (threads == 1) {
+            baseline = best;
+        }
+        double speedup = best > 0 ? baseline / best : 0;
+        printf("%-8d %-12.6f %-10.2f %-10.2f\n", threads, best, speedup, speedup / threads);
+    }
+}
+
+// Pool task to sum the values of one chunk (the bandwidth-bound baseline kernel)
+void sum_chunk(void *ctx, int worker_id, long long begin, long long end) {
+    ThreadData *data = &thread_data[worker_id];
+    (void)ctx;
+
+    data->partial_sum += sum_kernel(data->columns->values + begin, end - begin);
+    data->readings_processed += end - begin;
+    data->chunks_processed++;
+}
+
+// Called by each worker once the sum job has no chunks left
+void finish_sum(void *ctx, int worker_id) {
+    (void)ctx;
+    __atomic_fetch_add(&total_sum, thread_data[worker_id].partial_sum, __ATOMIC_RELAXED);
+}
+
+// Function to run the sum-only job on 'active' workers of the pool
+long long run_parallel_sum(ThreadPool *pool, int active, const SensorColumns *columns, long long chunk_size) {
+    for (int i = 0; i < pool->num_workers; i++) {
+        thread_data[i].columns = columns;
+        thread_data[i].partial_sum = 0;
+        thread_data[i].readings_processed = 0;
+        thread_data[i].chunks_processed = 0;
+    }
+    total_sum = 0;
+
+    pool_run(pool, active, columns->count, chunk_size, sum_chunk, finish_sum, pool);
+    return total_sum;
+}
+
+#define SELF_CHECK_STRIDE (1LL << 20)   // readings between the non-zero ones of --self-check
+
+// Function to set reading 'i' of a --self-check dataset to a value, type and
+// sector derived from 'i', and add it to the expected totals (once only).
+// Type code NUM_SENSOR_TYPES is out of range, as in a corrupt file: such a
+// reading is in the sum and its sector but in no type.
+static void self_check_set(SensorColumns *columns, long long i, long long *sum, GroupTotals *expected) {
+    if (i < 0 || i >= columns->count || columns->values[i] != 0) {
+        return;
+    }
+    uint16_t value = 1 + i % MAX_SENSOR_VALUE;
+    int type = 1 + i % NUM_SENSOR_TYPES;
+    int sector = i % NUM_SECTORS;
+    columns->values[i] = value;
+    columns->types[i] = type;
+    columns->sectors[i] = sector + 1;
+    *sum += value;
+    expected->sum += value;
+    expected->type_counts[0]--;
+    if (type < NUM_SENSOR_TYPES) {
+        expected->type_counts[type]++;
+        expected->type_sums[type] += value;
+    }
+    expected->sector_counts[sector]++;
+    expected->sector_sums[sector] += value;
+}
+
+// Function to aggregate 'count' synthetic readings, which may be well past
+// INT_MAX, and compare the results with the known answer. The columns are
+// one sparse anonymous mapping: untouched pages read as zeros (type 0, no
+// sector, value 0), and only every SELF_CHECK_STRIDE-th reading, those
+// around INT_MAX and the last few are set. Memory use and set-up time are
+// therefore tiny, while every count, sum and index still runs to 'count'.
+int run_self_check(ThreadPool *pool, int num_threads, long long chunk_size, long long count) {
+    SensorColumns columns;
+    memset(&columns, 0, sizeof(columns));
+    columns.mapping_size = count * (sizeof(uint16_t) + 2);
+    columns.mapping = mmap(NULL, columns.mapping_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (columns.mapping == MAP_FAILED) {
+        perror("Failed to map self-check readings");
+        return 1;
+    }
+    columns.values = (uint16_t *)columns.mapping;
+    columns.types = (uint8_t *)(columns.values + count);
+    columns.sectors = columns.types + count;
+    columns.count = count;
+
+    long long expected_sum = 0;
+    GroupTotals expected;
+    memset(&expected, 0, sizeof(expected));
+    expected.type_counts[0] = count;
+    for (long long i = 0; i < count; i += SELF_CHECK_STRIDE) {
+        self_check_set(&columns, i + i / SELF_CHECK_STRIDE % 4093, &expected_sum, &expected);
+    }
+    for (long long i = -2; i <= 2; i++) {
+        self_check_set(&columns, INT_MAX + i, &expected_sum, &expected);
+        self_check_set(&columns, UINT32_MAX + i, &expected_sum, &expected);
+    }
+    for (long long i = 1; i <= 3; i++) {
+        self_check_set(&columns, count - i, &expected_sum, &expected);
+    }
+
+    printf("Self-check: %lld readings (%s INT_MAX), %.1f GB mapped sparsely, %s kernels, %d threads\n",
+           count, count > INT_MAX ? "past" : "within", columns.mapping_size / 1e9, kernel_name, num_threads);
+    double start_time = now_seconds();
+    long long sum = run_parallel_aggregation(pool, num_threads, &columns, chunk_size, NULL, NULL);
+    long long processed = 0;
+    for (int i = 0; i < num_threads; i++) {
+        processed += thread_data[i].readings_processed;
+    }
+    int failures = 0;
+    if (sum != expected_sum || processed != count) {
+        printf("FAIL aggregation: sum %lld over %lld readings, expected %lld over %lld\n",
+               sum, processed, expected_sum, count);
+        failures++;
+    }
+    if (memcmp(&total_groups, &expected, sizeof(expected)) != 0) {
+        printf("FAIL aggregation: per-type or per-sector totals differ (type 0 count %lld, expected %lld)\n",
+               total_groups.type_counts[0], expected.type_counts[0]);
+        failures++;
+    }
+    sum = run_parallel_sum(pool, num_threads, &columns, chunk_size);
+    if (sum != expected_sum) {
+        printf("FAIL sum: %lld, expected %lld\n", sum, expected_sum);
+        failures++;
+    }
+    sum = sum_kernel(columns.values, count);
+    if (sum != expected_sum) {
+        printf("FAIL single-threaded sum: %lld, expected %lld\n", sum, expected_sum);
+        failures++;
+    }
+    printf("Self-check %s in %.2f seconds: sum %lld, %lld readings of type 0\n", failures == 0 ? "passed" : "FAILED",
+           now_seconds() - start_time, expected_sum, expected.type_counts[0]);
+
+    free_columns(&columns);
+    return failures != 0;
+}
+
+// Static partition job: worker w sums the range that worker targets[w]
+// owned when the data was generated (first-touched)
+typedef struct {
+    const SensorColumns *columns;
+    long long chunk_size;
+    int active;
+    const int *targets;
+} PartitionJob;
+
+// Pool task for PartitionJob; each worker is dealt exactly one item
+void sum_partition(void *ctx, int worker_id, long long begin, long long end) {
+    const PartitionJob *job = (const PartitionJob *)ctx;
+    ThreadData *data = &thread_data[worker_id];
+    long long num_chunks = (job->columns->count + job->chunk_size - 1) / job->chunk_size;
+    (void)begin;
+    (void)end;
+
+    long long first, last;
+    worker_chunk_range(num_chunks, job->active, job->targets[worker_id], &first, &last);
+    long long from = first * job->chunk_size;
+    long long to = last * job->chunk_size < job->columns->count ? last * job->chunk_size : job->columns->count;
+    if (to > from) {
+        data->partial_sum += sum_kernel(job->columns->values + from, to - from);
+    }
+}
+
+// Function to pick, for every worker, the partition it reads: its own for
+// the local run, or one first-touched by a worker on another NUMA node for
+// the remote run. A uniform shift is preferred so every partition is still
+// read exactly once. Returns 0 when no worker has a remote partner.
+int numa_partition_targets(ThreadPool *pool, int active, int remote, int *targets) {
+    for (int w = 0; w < active; w++) {
+        targets[w] = w;
+    }
+    if (!remote) {
+        return 1;
+    }
+
+    for (int shift = 1; shift < active; shift++) {
+        int all_remote = 1;
+        for (int w = 0; w < active && all_remote; w++) {
+            all_remote = pool->workers[(w + shift) % active].node != pool->workers[w].node;
+        }
+        if (all_remote) {
+            for (int w = 0; w < active; w++) {
+                targets[w] = (w + shift) % active;
+            }
+            return 1;
+        }
+    }
+
+    // Uneven node sizes: fall back to the nearest remote partner per worker
+    int found = 0;
+    for (int w = 0; w < active; w++) {
+        for (int k = 1; k < active; k++) {
+            int v = (w + k) % active;
+            if (pool->workers[v].node != pool->workers[w].node) {
+                targets[w] = v;
+                found = 1;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+// Function to run one static partition sum (no stealing, so each worker
+// stays on the partition it was given)
+long long run_partition_sum(ThreadPool *pool, int active, const SensorColumns *columns,
+                            long long chunk_size, const int *targets) {
+    PartitionJob job = {columns, chunk_size, active, targets};
+    for (int i = 0; i < pool->num_workers; i++) {
+        thread_data[i].partial_sum = 0;
+    }
+    total_sum = 0;
+
+    int saved_stealing = pool->stealing;
+    pool->stealing = 0;
+    pool_run(pool, active, active, 1, sum_partition, finish_sum, &job);
+    pool->stealing = saved_stealing;
+    return total_sum;
+}
+
+// Function to print the worker placement and local versus remote read
+// bandwidth over the partitions the workers first-touched
+void print_numa_report(ThreadPool *pool, int active, long long chunk_size) {
+    int targets[MAX_THREADS];
+
+    printf("\n===== NUMA Placement =====\n");
+    for (int w = 0; w < active; w++) {
+        printf("Thread %d: CPU %d, node %d\n", w, pool->workers[w].cpu, pool->workers[w].node);
+    }
+
+    double bytes = (double)sensor_data.count * sizeof(uint16_t);
+    for (int remote = 0; remote <= 1; remote++) {
+        if (!numa_partition_targets(pool, active, remote, targets)) {
+            printf("Remote bandwidth: n/a (all workers are on one NUMA node)\n");
+            continue;
+        }
+        double best = 0;
+        for (int rep = 0; rep < SCALING_REPETITIONS; rep++) {
+            double start = now_seconds();
+            run_partition_sum(pool, active, &sensor_data, chunk_size, targets);
+            double elapsed = now_seconds() - start;
+            if (rep == 0 || elapsed < best) {
+                best = elapsed;
+            }
+        }
+        printf("%s bandwidth: %.2f GB/s (%.6f seconds, best of %d)\n",
+               remote ? "Remote" : "Local", best > 0 ? bytes / best / 1e9 : 0, best, SCALING_REPETITIONS);
+    }
+}
+
+// Hardware and software performance counters, opened per worker thread
+// with perf_event_open. Each counter is opened on its own, so a machine
+// without a PMU (many VMs) still gets the software counters, and a run
+// without any counters still gets time and throughput.
+#define PERF_EVENTS 7
+
+static const char *perf_event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "LLC-misses", "branch-misses", "task-clock", "context-switches", "page-faults"
+};
+
+typedef struct {
+    int num_workers;
+    int (*fds)[PERF_EVENTS];        // [num_workers], -1 where a counter could not be opened
+    double (*start)[PERF_EVENTS];   // [num_workers], counts at the start of the phase
+    int available[PERF_EVENTS];     // workers on which each counter opened
+    double start_time;
+} PerfSession;
+
+PerfSession *perf_session = NULL;
+
+#ifdef HAVE_PERF_EVENTS
+// Function to open one counter on thread 'tid', counting user space only
+static int perf_open_counter(pid_t tid, int event) {
+    static const struct {
+        uint32_t type;
+        uint64_t config;
+    } events[PERF_EVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},   // last-level cache on most CPUs
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}
+    };
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = events[event].type;
+    attr.config = events[event].config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Scale by enabled/running time if the PMU has to multiplex counters
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+#endif
+
+// Function to open the counters for every worker of the pool. Returns NULL
+// only if memory runs out; unavailable counters are reported and skipped.
+PerfSession *perf_open(ThreadPool *pool) {
+    PerfSession *session = (PerfSession *)calloc(1, sizeof(PerfSession));
+    if (session == NULL) {
+        return NULL;
+    }
+    session->num_workers = pool->num_workers;
+    session->fds = malloc(pool->num_workers * sizeof(*session->fds));
+    session->start = calloc(pool->num_workers, sizeof(*session->start));
+    if (session->fds == NULL || session->start == NULL) {
+        free(session->fds);
+        free(session->start);
+        free(session);
+        return NULL;
+    }
+
+    int first_error = 0;
+    for (int w = 0; w < pool->num_workers; w++) {
+        // The worker publishes its thread id as it starts up
+        pid_t tid;
+        while ((tid = __atomic_load_n(&pool->workers[w].tid, __ATOMIC_ACQUIRE)) == 0) {
+            sched_yield();
+        }
+        for (int e = 0; e < PERF_EVENTS; e++) {
+#ifdef HAVE_PERF_EVENTS
+            session->fds[w][e] = perf_open_counter(tid, e);
+#else
+            session->fds[w][e] = -1;
+            errno = ENOSYS;
+#endif
+            if (session->fds[w][e] >= 0) {
+                session->available[e]++;
+            } else if (first_error == 0) {
+                first_error = errno;
+            }
+        }
+    }
+
+    int missing = 0;
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        missing += session->available[e] < session->num_workers;
+    }
+    if (missing > 0) {
+        FILE *paranoid = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+        int level = -9;
+        if (paranoid != NULL) {
+            if (fscanf(paranoid, "%d", &level) != 1) {
+                level = -9;
+            }
+            fclose(paranoid);
+        }
+        printf("Note: counters unavailable, shown as n/a:");
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (session->available[e] < session->num_workers) {
+                printf(" %s", perf_event_names[e]);
+            }
+        }
+        printf(" (%s", strerror(first_error));
+        if (level != -9) {
+            printf(", perf_event_paranoid=%d", level);
+        }
+        printf(")\n");
+    }
+    return session;
+}
+
+// Function to close every counter and free the session
+void perf_close(PerfSession *session) {
+    if (session == NULL) {
+        return;
+    }
+    for (int w = 0; w < session->num_workers; w++) {
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (session->fds[w][e] >= 0) {
+                close(session->fds[w][e]);
+            }
+        }
+    }
+    free(session->fds);
+    free(session->start);
+    free(session);
+}
+
+// Function to read the current counts of worker 'w', scaled for multiplexing;
+// -1 marks a counter that is not available
+static void perf_read_worker(const PerfSession *session, int w, double *counts) {
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        uint64_t value[3];
+        counts[e] = -1;
+        if (session->fds[w][e] >= 0 && read(session->fds[w][e], value, sizeof(value)) == sizeof(value)) {
+            counts[e] = value[2] > 0 ? (double)value[0] * value[1] / value[2] : 0;
+        }
+    }
+}
+
+// Function to mark the start of a phase
+void perf_phase_begin(PerfSession *session) {
+    for (int w = 0; w < session->num_workers; w++) {
+        perf_read_worker(session, w, session->start[w]);
+    }
+    session->start_time = now_seconds();
+}
+
+static void print_perf_count(double value, double scale, int width, int precision) {
+    if (value < 0) {
+        printf(" %*s", width, "n/a");
+    } else {
+        printf(" %*.*f", width, precision, value / scale);
+    }
+}
+
+// Function to end a phase and print its counters for each worker. Readings
+// per worker come from thread_data, which every pool task keeps up to date;
+// 'bytes_per_reading' is how much memory the phase touches per reading.
+void perf_phase_end(PerfSession *session, const char *phase, int active, int bytes_per_reading) {
+    double seconds = now_seconds() - session->start_time;
+    double totals[PERF_EVENTS] = {0};
+    long long readings = 0;
+
+    printf("\n===== Performance Counters: %s phase =====\n", phase);
+    printf("%-7s %11s %8s %9s %9s %5s %10s %10s %9s %7s %8s\n", "Worker", "Readings", "GB/s", "Cycles(M)",
+           "Instr(M)", "IPC", "LLC-miss(K)", "Br-miss(K)", "CPU(ms)", "Ctx-sw", "Faults");
+    for (int w = 0; w < active; w++) {
+        double counts[PERF_EVENTS];
+        perf_read_worker(session, w, counts);
+        for (int e = 0; e < PERF_EVENTS; e++) {
+            if (counts[e] >= 0) {
+                counts[e] -= session->start[w][e];
+                totals[e] += counts[e];
+            }
+        }
+        readings += thread_data[w].readings_processed;
+
+        // Throughput over the worker's own CPU time, or the phase wall time without task-clock
+        double busy = counts[4] > 0 ? counts[4] / 1e9 : seconds;
+        printf("%-7d %11lld %8.2f", w, thread_data[w].readings_processed,
+               busy > 0 ? thread_data[w].readings_processed * (double)bytes_per_reading / busy / 1e9 : 0);
+        print_perf_count(counts[0], 1e6, 9, 1);
+        print_perf_count(counts[1], 1e6, 9, 1);
+        print_perf_count(counts[0] > 0 && counts[1] >= 0 ? counts[1] / counts[0] : -1, 1, 5, 2);
+        print_perf_count(counts[2], 1e3, 11, 1);
+        print_perf_count(counts[3], 1e3, 10, 1);
+        print_perf_count(counts[4], 1e6, 9, 1);
+        print_perf_count(counts[5], 1, 7, 0);
+        print_perf_count(counts[6], 1, 8, 0);
+        printf("\n");
+    }
+
+    for (int e = 0; e < PERF_EVENTS; e++) {
+        if (session->available[e] < session->num_workers) {
+            totals[e] = -1;
+        }
+    }
+    printf("%-7s %11lld %8.2f", "all", readings, seconds > 0 ? readings * (double)bytes_per_reading / seconds / 1e9 : 0);
+    print_perf_count(totals[0], 1e6, 9, 1);
+    print_perf_count(totals[1], 1e6, 9, 1);
+    print_perf_count(totals[0] > 0 && totals[1] >= 0 ? totals[1] / totals[0] : -1, 1, 5, 2);
+    print_perf_count(totals[2], 1e3, 11, 1);
+    print_perf_count(totals[3], 1e3, 10, 1);
+    print_perf_count(totals[4], 1e6, 9, 1);
+    print_perf_count(totals[5], 1, 7, 0);
+    print_perf_count(totals[6], 1, 8, 0);
+    printf("\n");
+    printf("Wall time: %.4f seconds, %d bytes per reading", seconds, bytes_per_reading);
+    if (totals[2] >= 0 && readings > 0) {
+        printf(", %.3f LLC misses per 64-byte line", totals[2] / (readings * (double)bytes_per_reading / 64));
+    }
+    printf("\n");
+}
+
+// Benchmark settings collected from the command line
+typedef struct {
+    int warmup;
+    int trials;
+    long long threads[MAX_BENCH_POINTS];
+    int num_threads;
+    long long sizes[MAX_BENCH_POINTS];
+    int num_sizes;
+    long long chunk_size;
+    const char *format;     // "text", "csv" or "json"
+    const char *output;     // NULL for stdout
+    int numa;               // also time local versus remote partition reads
+    int generated_threads;  // worker count the dataset was first-touched with
+    int compare_pages;      // also time generation, and every point on a 4 KB page copy
+} BenchConfig;
+
+// Timing summary for one (kernel, size, thread count) point
+typedef struct {
+    const char *benchmark;
+    long long readings;
+    int threads;
+    double min, median, p99, mean;
+    double bytes_per_reading;
+} BenchResult;
+
+// Function to parse a comma-separated list of positive integers
+int parse_count_list(const char *text, long long *out, int max) {
+    int count = 0;
+    const char *p = text;
+
+    while (*p != '\0') {
+        char *end;
+        long long value = strtoll(p, &end, 10);
+        if (end == p || value < 1 || count == max) {
+            return -1;
+        }
+        out[count++] = value;
+        p = *end == ',' ? end + 1 : end;
+        if (*end != ',' && *end != '\0') {
+            return -1;
+        }
+    }
+    return count;
+}
+
+// Function to read the nearest-rank percentile 'p' (0-100) of sorted samples
+double percentile(const double *sorted, int count, double p) {
+    int rank = (int)((p / 100.0) * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// Function to time 'trials' runs of one benchmark after 'warmup' untimed runs
+BenchResult bench_point(ThreadPool *pool, const BenchConfig *config, const char *benchmark,
+                        const SensorColumns *columns, int threads) {
+    int generate = strncmp(benchmark, "generate", 8) == 0;
+    int aggregate = strncmp(benchmark, "aggregate", 9) == 0;
+    int partition = strcmp(benchmark, "sum-local") == 0 || strcmp(benchmark, "sum-remote") == 0;
+    int targets[MAX_THREADS];
+    if (partition) {
+        numa_partition_targets(pool, threads, strcmp(benchmark, "sum-remote") == 0, targets);
+    }
+    double *samples = (double *)calloc(config->trials, sizeof(double));
+    BenchResult result = {benchmark, columns->count, threads, 0, 0, 0, 0,
+                          generate ? sizeof(SensorReading) : aggregate ? 4.0 : 2.0};
+
+    for (int run = -config->warmup; run < config->trials; run++) {
+        double start = now_seconds();
+        if (generate) {
+            // Allocation, first-touch page faults and release are part of the cost
+            SensorColumns fresh;
+            if (allocate_columns_paged(&fresh, columns->count, columns->pages) != 0) {
+                printf("Memory allocation failed\n");
+                break;
+            }
+            generate_columns(pool, threads, config->chunk_size, &fresh, 1, DEFAULT_SPAN_SECONDS);
+            free_columns(&fresh);
+        } else if (aggregate) {
+            run_parallel_aggregation(pool, threads, columns, config->chunk_size, NULL, NULL);
+        } else if (partition) {
+            run_partition_sum(pool, threads, columns, config->chunk_size, targets);
+        } else {
+            run_parallel_sum(pool, threads, columns, config->chunk_size);
+        }
+        double elapsed = now_seconds() - start;
+        if (run >= 0) {
+            samples[run] = elapsed;
+        }
+    }
+
+    qsort(samples, config->trials, sizeof(double), compare_doubles);
+    double total = 0;
+    for (int i = 0; i < config->trials; i++) {
+        total += samples[i];
+    }
+    result.min = samples[0];
+    result.median = percentile(samples, config->trials, 50);
+    result.p99 = percentile(samples, config->trials, 99);
+    result.mean = total / config->trials;
+
+    free(samples);
+    return result;
+}
+
+// Function to emit one benchmark result in the configured format
+void print_bench_result(FILE *out, const BenchConfig *config, const BenchResult *r, int first) {
+    double readings_per_sec = r->median > 0 ? r->readings / r->median : 0;
+    double gb_per_sec = readings_per_sec * r->bytes_per_reading / 1e9;
+
+    if (strcmp(config->format, "csv") == 0) {
+        fprintf(out, "%s,%s,%lld,%d,%lld,%d,%.9f,%.9f,%.9f,%.9f,%.3f,%.3f\n",
+                r->benchmark, kernel_name, r->readings, r->threads, config->chunk_size, config->trials,
+                r->min, r->median, r->p99, r->mean, readings_per_sec / 1e6, gb_per_sec);
+    } else if (strcmp(config->format, "json") == 0) {
+        fprintf(out, "%s  {\"benchmark\": \"%s\", \"kernel\": \"%s\", \"readings\": %lld, \"threads\": %d, "
+                "\"chunk\": %lld, \"trials\": %d, \"min_s\": %.9f, \"median_s\": %.9f, \"p99_s\": %.9f, "
+                "\"mean_s\": %.9f, \"mreadings_per_s\": %.3f, \"gb_per_s\": %.3f}",
+                first ? "" : ",\n", r->benchmark, kernel_name, r->readings, r->threads, config->chunk_size,
+                config->trials, r->min, r->median, r->p99, r->mean, readings_per_sec / 1e6, gb_per_sec);
+    } else {
+        fprintf(out, "%-15s %-14lld %-8d %-12.6f %-12.6f %-12.6f %-10.2f\n",
+                r->benchmark, r->readings, r->threads, r->median, r->p99, r->min, gb_per_sec);
+    }
+}
+
+// Function to sweep both kernels over every configured size and thread
+// count, timing each point with the monotonic wall clock
+int run_benchmark(ThreadPool *pool, const BenchConfig *config) {
+    static const char *benchmarks[2][3] = {{"sum", "aggregate"},
+                                           {"generate-huge", "sum-huge", "aggregate-huge"}};
+    static const char *small_benchmarks[] = {"generate-4k", "sum-4k", "aggregate-4k"};
+    FILE *out = stdout;
+
+    // With --huge-pages every point is also timed on a copy backed by 4 KB pages
+    SensorColumns small_pages;
+    memset(&small_pages, 0, sizeof(small_pages));
+    if (config->compare_pages) {
+        if (allocate_columns_paged(&small_pages, sensor_data.count, PAGES_SMALL) != 0) {
+            printf("Memory allocation failed\n");
+            return 1;
+        }
+        memcpy(small_pages.values, sensor_data.values, sensor_data.count * sizeof(uint16_t));
+        memcpy(small_pages.types, sensor_data.types, sensor_data.count);
+        memcpy(small_pages.sectors, sensor_data.sectors, sensor_data.count);
+        memcpy(small_pages.timestamps, sensor_data.timestamps, sensor_data.count * sizeof(uint32_t));
+        print_page_backing("Dataset", &sensor_data);
+        print_page_backing("4 KB page copy", &small_pages);
+    }
+
+    if (config->output != NULL) {
+        out = fopen(config->output, "w");
+        if (out == NULL) {
+            perror("Failed to open benchmark output file");
+            free_columns(&small_pages);
+            return 1;
+        }
+    }
+
+    if (strcmp(config->format, "csv") == 0) {
+        fprintf(out, "benchmark,kernel,readings,threads,chunk,trials,min_s,median_s,p99_s,mean_s,"
+                     "mreadings_per_s,gb_per_s\n");
+    } else if (strcmp(config->format, "json") == 0) {
+        fprintf(out, "[\n");
+    } else {
+        fprintf(out, "\n===== Benchmark (%s kernels, %d warmup, %d trials) =====\n",
+                kernel_name, config->warmup, config->trials);
+        fprintf(out, "%-15s %-14s %-8s %-12s %-12s %-12s %-10s\n",
+                "Benchmark", "Readings", "Threads", "Median(s)", "P99(s)", "Min(s)", "GB/s");
+    }
+
+    int first = 1;
+    for (int s = 0; s < config->num_sizes; s++) {
+        for (int small = 0; small <= config->compare_pages; small++) {
+            // Every size is a prefix of the loaded dataset
+            SensorColumns view = small ? small_pages : sensor_data;
+            view.count = config->sizes[s];
+            const char **names = small ? small_benchmarks : benchmarks[config->compare_pages];
+            for (int b = 0; b < 2 + config->compare_pages; b++) {
+                for (int t = 0; t < config->num_threads; t++) {
+                    BenchResult result = bench_point(pool, config, names[b], &view, (int)config->threads[t]);
+                    print_bench_result(out, config, &result, first);
+                    first = 0;
+                    fflush(out);
+                }
+            }
+        }
+    }
+
+    // Local versus remote reads over the partitions each worker first-touched
+    if (config->numa) {
+        int targets[MAX_THREADS];
+        int threads = config->generated_threads;
+        for (int remote = 0; remote <= 1; remote++) {
+            if (!numa_partition_targets(pool, threads, remote, targets)) {
+                continue;
+            }
+            BenchResult result = bench_point(pool, config, remote ? "sum-remote" : "sum-local",
+                                             &sensor_data, threads);
+            print_bench_result(out, config, &result, first);
+            first = 0;
+        }
+    }
+
+    if (strcmp(config->format, "json") == 0) {
+        fprintf(out, "\n]\n");
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    free_columns(&small_pages);
+    return 0;
+}
+
+/*
+ * Live ingest
+ *
+ * Reader threads decode 8-byte wire records (uint16_t value, uint8_t type,
+ * uint8_t sector, uint32_t timestamp, little-endian; the SensorReading
+ * layout) from stdin, a FIFO/file or a Unix socket, and route each one by
+ * sector to an
+ * aggregator through a bounded lock-free MPSC ring. Aggregators keep
+ * per-second buckets for the last LIVE_HISTORY_SECONDS and running totals
+ * for each sliding window, and publish a snapshot every publish interval
+ * under a seqlock, so readers of the statistics never block the hot path.
+ * The sliding windows follow arrival time.
+ */
+#define LIVE_WINDOWS 3
+#define LIVE_HISTORY_SECONDS 3600
+#define LIVE_RING_CAPACITY 65536
+#define LIVE_READ_BUFFER 65536
+#define LIVE_MAX_CONNECTIONS 64      // gateway connections open at the same time
+#define LIVE_POLL_MS 100             // how often a waiting reader checks for an interrupt
+#define DEFAULT_PUBLISH_MS 50
+#define DEFAULT_REPORT_MS 1000
+
+static const int live_window_seconds[LIVE_WINDOWS] = {60, 300, 3600};
+
+// One slot of a ring; 'sequence' says whether it is free or holds a reading
+typedef struct {
+    size_t sequence;
+    SensorReading reading;
+} RingCell;
+
+// Bounded multi-producer/single-consumer ring (Vyukov's sequence-number
+// design). Producers claim slots with a CAS on 'head'; the single consumer
+// owns 'tail'. Full rings push back on the producers.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) size_t head;
+    _Alignas(CACHE_LINE_SIZE) size_t tail;
+    RingCell *cells;
+    size_t mask;
+} ReadingRing;
+
+// Running count and sum for every (window, type, sector)
+typedef struct {
+    long long counts[LIVE_WINDOWS][NUM_GROUPS];
+    long long sums[LIVE_WINDOWS][NUM_GROUPS];
+} WindowTotals;
+
+typedef struct LiveState LiveState;
+
+typedef struct {
+    ReadingRing ring;
+    pthread_t thread;
+    int id;
+    LiveState *live;
+
+    // Per-second history: bucket (second % LIVE_HISTORY_SECONDS)
+    long long (*bucket_counts)[NUM_GROUPS];
+    long long (*bucket_sums)[NUM_GROUPS];
+    long long current_second;
+    WindowTotals running;
+    long long processed;
+
+    // Snapshot published under a seqlock
+    _Alignas(CACHE_LINE_SIZE) unsigned sequence;
+    WindowTotals published;
+    long long published_processed;
+} LiveAggregator;
+
+struct LiveState {
+    LiveAggregator *aggregators;
+    int num_aggregators;
+    double start_time;
+    long long publish_ms;
+    int stop;               // aggregators drain their rings and exit
+    int readers_active;
+    long long dropped;      // malformed records
+    int listen_fd;
+    int connection_fds[LIVE_MAX_CONNECTIONS];           // -1 for a free slot
+    pthread_t connection_threads[LIVE_MAX_CONNECTIONS];
+    int connection_done[LIVE_MAX_CONNECTIONS];          // set by the reader as it exits
+};
+
+static volatile sig_atomic_t live_interrupted = 0;
+
+static void live_signal_handler(int signal_number) {
+    (void)signal_number;
+    live_interrupted = 1;
+}
+
+// Function to allocate a ring with a power-of-two capacity
+int ring_init(ReadingRing *ring, size_t capacity) {
+    ring->cells = (RingCell *)calloc(capacity, sizeof(RingCell));
+    if (ring->cells == NULL) {
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        ring->cells[i].sequence = i;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mask = capacity - 1;
+    return 0;
+}
+
+// Function to try to enqueue one reading; returns 0 when the ring is full
+int ring_push(ReadingRing *ring, SensorReading reading) {
+    size_t pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    RingCell *cell;
+
+    for (;;) {
+        cell = &ring->cells[pos & ring->mask];
+        size_t sequence = __atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->reading = reading;
+    __atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Function to dequeue one reading (single consumer); returns 0 when empty
+int ring_pop(ReadingRing *ring, SensorReading *reading) {
+    size_t pos = ring->tail;
+    RingCell *cell = &ring->cells[pos & ring->mask];
+
+    if (__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) != pos + 1) {
+        return 0;
+    }
+    *reading = cell->reading;
+    __atomic_store_n(&cell->sequence, pos + ring->mask + 1, __ATOMIC_RELEASE);
+    ring->tail = pos + 1;
+    return 1;
+}
+
+// Function to slide every window forward to 'second', retiring the buckets
+// that fall out of each window and recycling the oldest bucket
+void live_advance(LiveAggregator *agg, long long second) {
+    if (second - agg->current_second >= LIVE_HISTORY_SECONDS) {
+        // Idle for longer than the history: everything has expired
+        memset(&agg->running, 0, sizeof(agg->running));
+        memset(agg->bucket_counts, 0, LIVE_HISTORY_SECONDS * sizeof(*agg->bucket_counts));
+        memset(agg->bucket_sums, 0, LIVE_HISTORY_SECONDS * sizeof(*agg->bucket_sums));
+        agg->current_second = second;
+        return;
+    }
+
+    while (agg->current_second < second) {
+        long long next = ++agg->current_second;
+        for (int w = 0; w < LIVE_WINDOWS; w++) {
+            long long expired = next - live_window_seconds[w];
+            if (expired < 0) {
+                continue;
+            }
+            int slot = expired % LIVE_HISTORY_SECONDS;
+            for (int g = 0; g < NUM_GROUPS; g++) {
+                agg->running.counts[w][g] -= agg->bucket_counts[slot][g];
+                agg->running.sums[w][g] -= agg->bucket_sums[slot][g];
+            }
+        }
+        int slot = next % LIVE_HISTORY_SECONDS;
+        memset(agg->bucket_counts[slot], 0, sizeof(agg->bucket_counts[slot]));
+        memset(agg->bucket_sums[slot], 0, sizeof(agg->bucket_sums[slot]));
+    }
+}
+
+// Function to add one reading to the current bucket and every window
+static inline void live_add(LiveAggregator *agg, SensorReading reading) {
+    int group = reading.type * NUM_SECTORS + (reading.field_sector - 1);
+    int slot = agg->current_second % LIVE_HISTORY_SECONDS;
+
+    agg->bucket_counts[slot][group]++;
+    agg->bucket_sums[slot][group] += reading.value;
+    for (int w = 0; w < LIVE_WINDOWS; w++) {
+        agg->running.counts[w][group]++;
+        agg->running.sums[w][group] += reading.value;
+    }
+    agg->processed++;
+}
+
+// Function to publish the running totals under the aggregator's seqlock
+void live_publish(LiveAggregator *agg) {
+    __atomic_store_n(&agg->sequence, agg->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    agg->published = agg->running;
+    agg->published_processed = agg->processed;
+    __atomic_store_n(&agg->sequence, agg->sequence + 1, __ATOMIC_RELEASE);
+}
+
+// Function to copy an aggregator's latest published snapshot
+void live_read_snapshot(LiveAggregator *agg, WindowTotals *out, long long *processed) {
+    unsigned before, after;
+    do {
+        before = __atomic_load_n(&agg->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            continue;
+        }
+        *out = agg->published;
+        *processed = agg->published_processed;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&agg->sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
+
+// Function to read the live clock: whole seconds since ingest started
+static long long live_second(const LiveState *live) {
+    return (long long)(now_seconds() - live->start_time);
+}
+
+// Aggregator thread: drain the ring, keep the windows current, and publish
+// at least every publish interval, even when no readings arrive
+void *live_aggregator_main(void *arg) {
+    LiveAggregator *agg = (LiveAggregator *)arg;
+    LiveState *live = agg->live;
+    double publish_interval = live->publish_ms / 1000.0;
+    double next_publish = now_seconds() + publish_interval;
+    SensorReading reading;
+
+    for (;;) {
+        // Drain in bounded bursts so the clock and publishing stay timely
+        int drained = 0;
+        while (drained < 4096 && ring_pop(&agg->ring, &reading)) {
+            live_add(agg, reading);
+            drained++;
+        }
+
+        double now = now_seconds();
+        live_advance(agg, (long long)(now - live->start_time));
+        if (now >= next_publish) {
+            live_publish(agg);
+            next_publish = now + publish_interval;
+        }
+
+        if (drained == 0) {
+            if (__atomic_load_n(&live->stop, __ATOMIC_ACQUIRE)) {
+                // Producers are gone: one last drain, then a final snapshot
+                while (ring_pop(&agg->ring, &reading)) {
+                    live_add(agg, reading);
+                }
+                live_publish(agg);
+                break;
+            }
+            struct timespec idle = {0, 100000};   // 100 us
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+// Function to route one decoded reading to the aggregator owning its sector
+static void live_route(LiveState *live, SensorReading reading) {
+    if (reading.type >= NUM_SENSOR_TYPES || reading.field_sector < 1 ||
+        reading.field_sector > NUM_SECTORS || reading.value > MAX_SENSOR_VALUE) {
+        __atomic_fetch_add(&live->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    LiveAggregator *agg = &live->aggregators[(reading.field_sector - 1) % live->num_aggregators];
+    while (!ring_push(&agg->ring, reading)) {
+        // Ring full: back-pressure the reader instead of growing memory
+        if (__atomic_load_n(&live->stop, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+        sched_yield();
+    }
+}
+
+typedef struct {
+    LiveState *live;
+    int fd;
+    int *done;              // flag set on exit, NULL if nobody waits for it
+} LiveReader;
+
+// Reader thread: decode fixed-size records from one descriptor until EOF
+// or an interrupt. It waits in poll rather than read, so even a reader of
+// a silent FIFO or terminal notices the interrupt and can be joined.
+void *live_reader_main(void *arg) {
+    LiveReader *reader = (LiveReader *)arg;
+    LiveState *live = reader->live;
+    unsigned char buffer[LIVE_READ_BUFFER];
+    size_t pending = 0;
+    struct pollfd ready = {reader->fd, POLLIN, 0};
+
+    while (!live_interrupted) {
+        int polled = poll(&ready, 1, LIVE_POLL_MS);
+        if (polled == 0 || (polled < 0 && errno == EINTR)) {
+            continue;
+        }
+        if (polled < 0) {
+            break;
+        }
+        ssize_t got = read(reader->fd, buffer + pending, sizeof(buffer) - pending);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        pending += got;
+
+        size_t whole = pending / sizeof(SensorReading) * sizeof(SensorReading);
+        for (size_t offset = 0; offset < whole; offset += sizeof(SensorReading)) {
+            SensorReading reading;
+            memcpy(&reading, buffer + offset, sizeof(reading));
+            live_route(live, reading);
+        }
+        // Keep a partial record for the next read
+        memmove(buffer, buffer + whole, pending - whole);
+        pending -= whole;
+    }
+
+    __atomic_fetch_sub(&live->readers_active, 1, __ATOMIC_RELEASE);
+    if (reader->done != NULL) {
+        __atomic_store_n(reader->done, 1, __ATOMIC_RELEASE);
+    }
+    free(reader);
+    return NULL;
+}
+
+// Function to start a reader thread on 'fd'; it sets '*done' as it exits
+int live_start_reader(LiveState *live, int fd, pthread_t *thread, int *done) {
+    LiveReader *reader = (LiveReader *)malloc(sizeof(LiveReader));
+    if (reader == NULL) {
+        return -1;
+    }
+    reader->live = live;
+    reader->fd = fd;
+    reader->done = done;
+
+    __atomic_fetch_add(&live->readers_active, 1, __ATOMIC_RELEASE);
+    if (pthread_create(thread, NULL, live_reader_main, reader) != 0) {
+        __atomic_fetch_sub(&live->readers_active, 1, __ATOMIC_RELEASE);
+        free(reader);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to check that the process at the other end of Unix socket 'fd'
+// runs as this user; 0 if it does
+int peer_is_same_user(int fd) {
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 ||
+        credentials.uid != geteuid()) {
+        return -1;
+    }
+    return 0;
+}
+
+// Function to join the readers of gateway connections that have closed
+// and free their slots for new gateways
+static void live_reap_connections(LiveState *live) {
+    for (int c = 0; c < LIVE_MAX_CONNECTIONS; c++) {
+        if (live->connection_fds[c] >= 0 && __atomic_load_n(&live->connection_done[c], __ATOMIC_ACQUIRE)) {
+            pthread_join(live->connection_threads[c], NULL);
+            close(live->connection_fds[c]);
+            live->connection_fds[c] = -1;
+        }
+    }
+}
+
+// Listener thread: accept gateway connections on the Unix socket, one
+// reader thread per connection, until interrupted. Only processes of the
+// same user may push readings, and at most LIVE_MAX_CONNECTIONS at a time.
+void *live_listener_main(void *arg) {
+    LiveState *live = (LiveState *)arg;
+
+    while (!live_interrupted) {
+        int fd = accept(live->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (peer_is_same_user(fd) != 0) {
+            printf("Warning: rejecting gateway connection from another user\n");
+            close(fd);
+            continue;
+        }
+        live_reap_connections(live);
+        int slot = 0;
+        while (slot < LIVE_MAX_CONNECTIONS && live->connection_fds[slot] >= 0) {
+            slot++;
+        }
+        if (slot == LIVE_MAX_CONNECTIONS) {
+            printf("Warning: rejecting gateway connection (limit %d open)\n", LIVE_MAX_CONNECTIONS);
+            close(fd);
+            continue;
+        }
+        live->connection_done[slot] = 0;
+        if (live_start_reader(live, fd, &live->connection_threads[slot], &live->connection_done[slot]) != 0) {
+            printf("Warning: rejecting gateway connection (no reader thread)\n");
+            close(fd);
+            continue;
+        }
+        live->connection_fds[slot] = fd;
+    }
+
+    __atomic_fetch_sub(&live->readers_active, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Function to open a listening Unix-domain stream socket at 'path'. A
+// socket left there by an earlier run is replaced; any other file is not.
+int live_listen_unix(const char *path) {
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        printf("Error: socket path '%s' is too long\n", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    struct stat existing;
+    if (lstat(path, &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path);
+    }
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+        perror("Failed to listen on socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to print the merged sliding-window statistics
+void print_live_report(LiveState *live) {
+    WindowTotals merged, snapshot;
+    long long processed = 0;
+    memset(&merged, 0, sizeof(merged));
+
+    for (int a = 0; a < live->num_aggregators; a++) {
+        long long agg_processed;
+        live_read_snapshot(&live->aggregators[a], &snapshot, &agg_processed);
+        processed += agg_processed;
+        for (int w = 0; w < LIVE_WINDOWS; w++) {
+            for (int g = 0; g < NUM_GROUPS; g++) {
+                merged.counts[w][g] += snapshot.counts[w][g];
+                merged.sums[w][g] += snapshot.sums[w][g];
+            }
+        }
+    }
+
+    printf("\n===== Live Sensor Windows (t=%llds, %lld readings, %lld dropped) =====\n",
+           live_second(live), processed, __atomic_load_n(&live->dropped, __ATOMIC_RELAXED));
+    printf("%-18s %12s %10s %10s %10s\n", "Group", "Count(1m)", "Avg(1m)", "Avg(5m)", "Avg(60m)");
+
+    for (int t = 0; t < NUM_SENSOR_TYPES + NUM_SECTORS; t++) {
+        long long counts[LIVE_WINDOWS] = {0}, sums[LIVE_WINDOWS] = {0};
+        for (int w = 0; w < LIVE_WINDOWS; w++) {
+            for (int k = 0; k < (t < NUM_SENSOR_TYPES ? NUM_SECTORS : NUM_SENSOR_TYPES); k++) {
+                int group = t < NUM_SENSOR_TYPES ? t * NUM_SECTORS + k
+                                                 : k * NUM_SECTORS + (t - NUM_SENSOR_TYPES);
+                counts[w] += merged.counts[w][group];
+                sums[w] += merged.sums[w][group];
+            }
+        }
+        if (counts[LIVE_WINDOWS - 1] == 0) {
+            continue;
+        }
+
+        char label[32];
+        if (t < NUM_SENSOR_TYPES) {
+            snprintf(label, sizeof(label), "%s", get_sensor_type_name((SensorType)t));
+        } else {
+            snprintf(label, sizeof(label), "Sector %d", t - NUM_SENSOR_TYPES + 1);
+        }
+        printf("%-18s %12lld", label, counts[0]);
+        for (int w = 0; w < LIVE_WINDOWS; w++) {
+            if (counts[w] > 0) {
+                printf(" %10.2f", (double)sums[w] / counts[w]);
+            } else {
+                printf(" %10s", "-");
+            }
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+// Function to run the long-lived ingest: "-" reads stdin, "unix:PATH"
+// listens on a Unix socket, anything else is opened as a FIFO or file.
+// File sources end at EOF; the socket runs until SIGINT/SIGTERM.
+int run_live(const char *source, int num_aggregators, long long publish_ms, long long report_ms) {
+    LiveState live;
+    memset(&live, 0, sizeof(live));
+    live.num_aggregators = num_aggregators;
+    live.publish_ms = publish_ms;
+    live.start_time = now_seconds();
+    live.listen_fd = -1;
+    for (int c = 0; c < LIVE_MAX_CONNECTIONS; c++) {
+        live.connection_fds[c] = -1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = live_signal_handler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    live.aggregators = (LiveAggregator *)aligned_alloc(CACHE_LINE_SIZE, num_aggregators * sizeof(LiveAggregator));
+    if (live.aggregators == NULL) {
+        printf("Memory allocation failed\n");
+        return 1;
+    }
+    memset(live.aggregators, 0, num_aggregators * sizeof(LiveAggregator));
+
+    int started = 0;
+    for (int a = 0; a < num_aggregators; a++) {
+        LiveAggregator *agg = &live.aggregators[a];
+        agg->id = a;
+        agg->live = &live;
+        agg->bucket_counts = calloc(LIVE_HISTORY_SECONDS, sizeof(*agg->bucket_counts));
+        agg->bucket_sums = calloc(LIVE_HISTORY_SECONDS, sizeof(*agg->bucket_sums));
+        if (agg->bucket_counts == NULL || agg->bucket_sums == NULL ||
+            ring_init(&agg->ring, LIVE_RING_CAPACITY) != 0 ||
+            pthread_create(&agg->thread, NULL, live_aggregator_main, agg) != 0) {
+            printf("Failed to start aggregator %d\n", a);
+            break;
+        }
+        started++;
+    }
+
+    pthread_t source_thread;
+    int source_started = 0;
+    int source_fd = -1;
+    if (started == num_aggregators) {
+        if (strncmp(source, "unix:", 5) == 0) {
+            live.listen_fd = live_listen_unix(source + 5);
+            if (live.listen_fd >= 0) {
+                live.readers_active = 1;    // the listener counts as a reader
+                source_started = pthread_create(&source_thread, NULL, live_listener_main, &live) == 0;
+            }
+        } else {
+            source_fd = strcmp(source, "-") == 0 ? STDIN_FILENO : open(source, O_RDONLY);
+            if (source_fd < 0) {
+                perror("Failed to open live source");
+            } else {
+                source_started = live_start_reader(&live, source_fd, &source_thread, NULL) == 0;
+            }
+        }
+    }
+
+    if (source_started) {
+        printf("Live ingest from '%s' with %d aggregator(s); windows 1/5/60 min, publish every %lld ms\n",
+               source, num_aggregators, publish_ms);
+        fflush(stdout);
+
+        // Report on a fixed cadence until the sources end or we are interrupted
+        double next_report = now_seconds() + report_ms / 1000.0;
+        while (!live_interrupted && __atomic_load_n(&live.readers_active, __ATOMIC_ACQUIRE) > 0) {
+            struct timespec tick = {0, 10 * 1000000};   // 10 ms
+            nanosleep(&tick, NULL);
+            if (now_seconds() >= next_report) {
+                print_live_report(&live);
+                next_report += report_ms / 1000.0;
+            }
+        }
+
+        // Unblock the listener and connection readers, then wait for them
+        if (live.listen_fd >= 0) {
+            shutdown(live.listen_fd, SHUT_RDWR);
+            pthread_join(source_thread, NULL);
+            for (int c = 0; c < LIVE_MAX_CONNECTIONS; c++) {
+                if (live.connection_fds[c] < 0) {
+                    continue;
+                }
+                shutdown(live.connection_fds[c], SHUT_RDWR);
+                pthread_join(live.connection_threads[c], NULL);
+                close(live.connection_fds[c]);
+            }
+            close(live.listen_fd);
+            unlink(source + 5);
+        } else {
+            // The reader stops within LIVE_POLL_MS of an interrupt
+            pthread_join(source_thread, NULL);
+        }
+    }
+
+    __atomic_store_n(&live.stop, 1, __ATOMIC_RELEASE);
+    for (int a = 0; a < started; a++) {
+        pthread_join(live.aggregators[a].thread, NULL);
+    }
+    if (source_started) {
+        print_live_report(&live);
+    }
+
+    for (int a = 0; a < num_aggregators; a++) {
+        free(live.aggregators[a].ring.cells);
+        free(live.aggregators[a].bucket_counts);
+        free(live.aggregators[a].bucket_sums);
+    }
+    free(live.aggregators);
+    if (source_fd > STDIN_FILENO) {
+        close(source_fd);
+    }
+    return source_started ? 0 : 1;
+}
+
+// Function to write 'count' generated readings in the live wire format
+int emit_wire_records(long long count, uint64_t seed) {
+    SensorReading buffer[LIVE_READ_BUFFER / sizeof(SensorReading)];
+    const long long per_write = sizeof(buffer) / sizeof(SensorReading);
+
+    for (long long i = 0; i < count; i += per_write) {
+        long long batch = count - i < per_write ? count - i : per_write;
+        uint32_t timestamp = (uint32_t)time(NULL);
+        for (long long k = 0; k < batch; k++) {
+            buffer[k] = make_reading(seed, i + k, timestamp);
+        }
+        if (fwrite(buffer, sizeof(SensorReading), batch, stdout) != (size_t)batch) {
+            return 1;
+        }
+    }
+    return fflush(stdout) == 0 ? 0 : 1;
+}
+
+// Function to print command-line usage
+void print_usage(const char *program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  -n, --readings N    Number of sensor readings (prompted if omitted)\n");
+    printf("  -t, --threads N     Worker threads (default: SENSOR_THREADS or online cores)\n");
+    printf("  -c, --chunk N       Readings per stealable chunk (default: %d)\n", DEFAULT_CHUNK_SIZE);
+    printf("  -i, --input FILE    Aggregate a dataset file in place (mmap) instead of generating data\n");
+    printf("      --verify-checksum  Check the dataset or archive checksum before aggregating it\n");
+    printf("                      (--stream, --ingest and --coordinator read the files once more for it)\n");
+    printf("  -s, --stream FILE   Aggregate a dataset file of any size in constant memory\n");
+    printf("      --batch N       Readings per streamed batch (default: %d, or %d with --ingest)\n",
+           DEFAULT_STREAM_BATCH, DEFAULT_INGEST_BATCH);
+    printf("      --ingest SRC    Aggregate every dataset file in directory SRC, or listed in @LISTFILE\n");
+    printf("      --io-depth N    Reads kept in flight while ingesting (default: %d)\n", DEFAULT_INGEST_DEPTH);
+    printf("      --io NAME       Ingest I/O backend: uring or pread (default: uring, pread if unavailable)\n");
+    printf("      --seed S        Seed for the generated readings (default: current time)\n");
+    printf("      --span S        Seconds of simulated time the generated readings cover (default: %d)\n",
+           DEFAULT_SPAN_SECONDS);
+    printf("  -o, --write FILE    Save the generated readings as a dataset file\n");
+    printf("      --write-archive FILE  Save the readings as a compressed block archive\n");
+    printf("  -a, --archive FILE  Aggregate a compressed archive, decoding blocks on the fly\n");
+    printf("      --kernel NAME   Force the avx2, sse2 or scalar kernels (default: best supported)\n");
+    printf("      --window S      Rolling statistics window ending at the newest reading (default: %d)\n",
+           DEFAULT_ROLLING_WINDOW);
+    printf("      --query SEC:TYPE  Rolling statistics for one sector and sensor type, e.g. 7:soil\n");
+    printf("      --where FILTER  Run a filtered query instead, e.g. type=light,sector=3-9,value>800\n");
+    printf("      --group-by KEY  Group query results by none, type or sector (default: none)\n");
+    printf("      --sketch KIND   Report min/p5/p50/p95/max from per-worker sketches: hist (exact) or kll\n");
+    printf("      --scaling       Print the aggregation scaling curve from 1 to N threads\n");
+    printf("      --self-check N  Aggregate N sparse synthetic readings (any count, e.g. past 2^31)\n");
+    printf("                      and compare the results with the known answer\n");
+    printf("      --bench         Benchmark the sum and aggregation kernels instead of a normal run\n");
+    printf("      --warmup N      Untimed runs before each benchmark point (default: %d)\n", DEFAULT_BENCH_WARMUP);
+    printf("      --trials N      Timed runs per benchmark point (default: %d)\n", DEFAULT_BENCH_TRIALS);
+    printf("      --bench-threads LIST  Thread counts to sweep, e.g. 1,2,4,8 (default: powers of two up to -t)\n");
+    printf("      --bench-sizes LIST    Dataset sizes to sweep (default: n); the largest sets n\n");
+    printf("      --format FMT    Benchmark output: text, csv or json (default: text)\n");
+    printf("      --bench-out FILE      Write benchmark results to FILE instead of stdout\n");
+    printf("      --perf          Report per-worker cycles, instructions, LLC and branch misses,\n");
+    printf("                      CPU time, context switches and page faults for each phase\n");
+    printf("      --huge-pages KIND  Back reading buffers with thp, 2m or 1g (hugetlb) pages and report\n");
+    printf("                      how many were obtained; --bench also times a 4 KB page copy\n");
+    printf("      --pin           Pin worker i to the i-th allowed CPU\n");
+    printf("      --numa          Pin workers, keep each on the pages it first-touched (no stealing)\n");
+    printf("                      and report local versus remote read bandwidth\n");
+    printf("      --live SRC      Run continuously on wire records from SRC: '-' (stdin), a FIFO/file,\n");
+    printf("                      or unix:PATH (listen on a Unix socket until SIGINT)\n");
+    printf("      --aggregators N Live aggregator threads; sectors are split across them (default: 2)\n");
+    printf("      --publish-ms N  Live snapshot publish interval (default: %d)\n", DEFAULT_PUBLISH_MS);
+    printf("      --report-ms N   Live report interval (default: %d)\n", DEFAULT_REPORT_MS);
+    printf("      --emit N        Write N generated readings to stdout in the live wire format\n");
+    printf("      --coordinator FILE  Split dataset FILE into shards aggregated by worker processes\n");
+    printf("      --workers N     Worker processes to start; 0 waits for external ones (default: 2)\n");
+    printf("      --shards N      Shards to split the dataset into (default: 4 per worker)\n");
+    printf("      --socket PATH   Unix socket the coordinator listens on (default: in a private /tmp directory)\n");
+    printf("      --shard-timeout S  Seconds a worker may hold a shard before it is reassigned (default: %d)\n",
+           DEFAULT_SHARD_TIMEOUT);
+    printf("      --shard-worker ADDR  Aggregate shards for the coordinator at unix:PATH\n");
+    printf("  -h, --help          Show this help\n");
+}
+
+// Function to fold one value into running statistics (Welford's update)
+static inline void running_stats_add(RunningStats *stats, uint16_t value) {
+    if (stats->count == 0 || value < stats->min) {
+        stats->min = value;
+    }
+    if (stats->count == 0 || value > stats->max) {
+        stats->max = value;
+    }
+    stats->count++;
+    double delta = value - stats->mean;
+    stats->mean += delta / stats->count;
+    stats->m2 += delta * (value - stats->mean);
+}
+
+// Function to combine two sets of running statistics (Chan et al.'s
+// pairwise update), so buckets merge without revisiting their readings
+void running_stats_merge(RunningStats *into, const RunningStats *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->count == 0) {
+        *into = *from;
+        return;
+    }
+    long long count = into->count + from->count;
+    double delta = from->mean - into->mean;
+    into->m2 += from->m2 + delta * delta * ((double)into->count * from->count / count);
+    into->mean += delta * from->count / count;
+    into->count = count;
+    if (from->min < into->min) {
+        into->min = from->min;
+    }
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+}
+
+// Function to allocate empty rolling statistics
+RollingStats *rolling_create() {
+    RollingStats *rolling = (RollingStats *)malloc(sizeof(RollingStats));
+    if (rolling != NULL) {
+        rolling_reset(rolling);
+    }
+    return rolling;
+}
+
+// Function to empty rolling statistics. Bucket slots are cleared on first
+// use, so only their ids are reset here.
+void rolling_reset(RollingStats *rolling) {
+    for (int b = 0; b < ROLLING_BUCKETS; b++) {
+        rolling->bucket_ids[b] = -1;
+    }
+    rolling->newest_bucket = -1;
+    rolling->newest_timestamp = 0;
+    rolling->late = 0;
+}
+
+// Function to fold readings [begin, end) into rolling statistics. Readings
+// may arrive out of order. Those in buckets before 'oldest_bucket' (the
+// history retained before this batch) are counted as late and skipped,
+// as are readings whose slot already holds a bucket a day newer.
+void rolling_add_range(RollingStats *rolling, const SensorColumns *columns, long long begin, long long end,
+                       long long oldest_bucket) {
+    for (long long i = begin; i < end; i++) {
+        int type = columns->types[i];
+        int sector = columns->sectors[i];
+        if (type >= NUM_SENSOR_TYPES || sector < 1 || sector > NUM_SECTORS) {
+            continue;
+        }
+
+        long long timestamp = columns->timestamps[i];
+        long long bucket = timestamp / ROLLING_BUCKET_SECONDS;
+        if (bucket < oldest_bucket) {
+            rolling->late++;
+            continue;
+        }
+        if (timestamp > rolling->newest_timestamp) {
+            rolling->newest_timestamp = timestamp;
+            rolling->newest_bucket = bucket;
+        }
+
+        // A slot still holding an older bucket is recycled on first use
+        int slot = bucket % ROLLING_BUCKETS;
+        if (rolling->bucket_ids[slot] != bucket) {
+            if (rolling->bucket_ids[slot] > bucket) {
+                rolling->late++;
+                continue;
+            }
+            memset(rolling->buckets[slot], 0, sizeof(rolling->buckets[slot]));
+            rolling->bucket_ids[slot] = bucket;
+        }
+        running_stats_add(&rolling->buckets[slot][type * NUM_SECTORS + (sector - 1)], columns->values[i]);
+    }
+}
+
+// Function to merge one worker's rolling buckets into 'into' (Chan et
+// al.'s update per group). Buckets that are a day or more older than the
+// newest reading of either side have aged out and are dropped.
+void rolling_merge(RollingStats *into, const RollingStats *from) {
+    into->late += from->late;
+    if (from->newest_timestamp > into->newest_timestamp) {
+        into->newest_timestamp = from->newest_timestamp;
+        into->newest_bucket = from->newest_bucket;
+    }
+    for (int slot = 0; slot < ROLLING_BUCKETS; slot++) {
+        long long bucket = from->bucket_ids[slot];
+        if (bucket < 0 || bucket <= into->newest_bucket - ROLLING_BUCKETS) {
+            continue;
+        }
+        if (into->bucket_ids[slot] != bucket) {
+            memset(into->buckets[slot], 0, sizeof(into->buckets[slot]));
+            into->bucket_ids[slot] = bucket;
+        }
+        for (int g = 0; g < NUM_GROUPS; g++) {
+            running_stats_merge(&into->buckets[slot][g], &from->buckets[slot][g]);
+        }
+    }
+}
+
+// Function to answer a rolling query: statistics of 'type' (-1 for all)
+// in 'sector' (0 for all) over the last 'window' seconds of data
+RunningStats rolling_query(const RollingStats *rolling, int type, int sector, long long window) {
+    RunningStats result;
+    memset(&result, 0, sizeof(result));
+    if (rolling->newest_bucket < 0) {
+        return result;
+    }
+
+    long long first = (rolling->newest_timestamp - window) / ROLLING_BUCKET_SECONDS + 1;
+    if (first < rolling->newest_bucket - ROLLING_BUCKETS + 1) {
+        first = rolling->newest_bucket - ROLLING_BUCKETS + 1;
+    }
+    for (long long bucket = first; bucket <= rolling->newest_bucket; bucket++) {
+        int slot = bucket % ROLLING_BUCKETS;
+        if (rolling->bucket_ids[slot] != bucket) {
+            continue;
+        }
+        for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+            for (int s = 1; s <= NUM_SECTORS; s++) {
+                if ((type < 0 || type == t) && (sector == 0 || sector == s)) {
+                    running_stats_merge(&result, &rolling->buckets[slot][t * NUM_SECTORS + (s - 1)]);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Function to parse a sensor type given as 0-4 or a name prefix such as "soil"
+int parse_sensor_type(const char *text) {
+    if (isdigit((unsigned char)text[0]) && text[1] == '\0') {
+        return text[0] - '0' < NUM_SENSOR_TYPES ? text[0] - '0' : -1;
+    }
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        const char *name = get_sensor_type_name((SensorType)t);
+        size_t k = 0;
+        while (text[k] != '\0' && tolower((unsigned char)text[k]) == tolower((unsigned char)name[k])) {
+            k++;
+        }
+        if (k > 0 && text[k] == '\0') {
+            return t;
+        }
+    }
+    return -1;
+}
+
+// Function to print one row of rolling statistics
+static void print_running_stats(const char *label, const RunningStats *stats) {
+    if (stats->count == 0) {
+        printf("%-26s %12d %10s %10s %6s %6s\n", label, 0, "-", "-", "-", "-");
+        return;
+    }
+    double stddev = stats->count > 1 ? sqrt(stats->m2 / (stats->count - 1)) : 0.0;
+    printf("%-26s %12lld %10.2f %10.2f %6u %6u\n",
+           label, stats->count, stats->mean, stddev, stats->min, stats->max);
+}
+
+// Function to print the rolling statistics per sensor type, and for one
+// (sector, type) pair when a query was given
+void print_rolling_report(const RollingStats *rolling, long long window, int query_sector, int query_type) {
+    char newest[32];
+    time_t newest_time = (time_t)rolling->newest_timestamp;
+    struct tm utc;
+    gmtime_r(&newest_time, &utc);
+    strftime(newest, sizeof(newest), "%Y-%m-%d %H:%M:%S", &utc);
+
+    printf("\n===== Rolling Statistics (last %lld s of data, up to %s UTC) =====\n", window, newest);
+    printf("%-26s %12s %10s %10s %6s %6s\n", "Group", "Count", "Mean", "StdDev", "Min", "Max");
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        RunningStats stats = rolling_query(rolling, t, 0, window);
+        print_running_stats(get_sensor_type_name((SensorType)t), &stats);
+    }
+    if (query_sector > 0) {
+        char label[48];
+        snprintf(label, sizeof(label), "Sector %d %s", query_sector,
+                 get_sensor_type_name((SensorType)query_type));
+        RunningStats stats = rolling_query(rolling, query_type, query_sector, window);
+        printf("Query:\n");
+        print_running_stats(label, &stats);
+    }
+    if (rolling->late > 0) {
+        printf("Late readings outside the retained history: %lld\n", rolling->late);
+    }
+}
+
+/*
+ * Predicate queries
+ *
+ * A query filters on sensor types, sectors and a value range, optionally
+ * groups by type or sector, and returns count, sum, min, max and average
+ * per group. The index splits the dataset into INDEX_BLOCK-reading blocks
+ * with a zone map (value min/max) and type/sector presence bits, plus one
+ * bitmap per type and per sector with a bit per reading. Blocks that
+ * cannot match are skipped outright. In the rest, the type and sector
+ * bitmaps are OR-ed and AND-ed 64 readings at a time, and the value range
+ * is checked with the SIMD range-mask kernel only where it can matter.
+ */
+#define INDEX_BLOCK 4096
+#define INDEX_WORDS (INDEX_BLOCK / 64)
+#define ALL_TYPES ((1u << NUM_SENSOR_TYPES) - 1)
+#define ALL_SECTORS ((1u << NUM_SECTORS) - 1)
+
+typedef enum {
+    GROUP_NONE,
+    GROUP_BY_TYPE,
+    GROUP_BY_SECTOR
+} QueryGrouping;
+
+// Filter and grouping of one query
+typedef struct {
+    uint32_t type_mask;         // bit t selects sensor type t
+    uint32_t sector_mask;       // bit s-1 selects sector s
+    uint16_t value_min;         // inclusive value range
+    uint16_t value_max;
+    QueryGrouping group_by;
+} SensorQuery;
+
+// Aggregates of one result group
+typedef struct {
+    long long count;
+    long long sum;
+    uint16_t min;
+    uint16_t max;
+} QueryAggregate;
+
+// Per-worker query results, each on its own cache lines
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) QueryAggregate groups[NUM_SECTORS];
+    long long blocks_scanned;
+    long long blocks_skipped;
+} QueryPartial;
+
+// Zone maps and bitmap indexes over one set of columns
+typedef struct {
+    const SensorColumns *columns;
+    long long num_blocks;
+    uint16_t *block_min;
+    uint16_t *block_max;
+    uint32_t *block_types;      // bit t: the block holds type t
+    uint32_t *block_sectors;    // bit s-1: the block holds sector s
+    uint64_t *type_bitmaps[NUM_SENSOR_TYPES];
+    uint64_t *sector_bitmaps[NUM_SECTORS];
+} SensorIndex;
+
+typedef struct {
+    const SensorIndex *index;
+    const SensorQuery *query;
+    QueryPartial *partials;
+} QueryJob;
+
+// Function to release an index
+void index_free(SensorIndex *index) {
+    free(index->block_min);
+    free(index->block_max);
+    free(index->block_types);
+    free(index->block_sectors);
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        free(index->type_bitmaps[t]);
+    }
+    for (int s = 0; s < NUM_SECTORS; s++) {
+        free(index->sector_bitmaps[s]);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+// Pool task to index blocks [begin, end). Each block owns whole bitmap
+// words, so workers never write to the same word.
+void index_blocks(void *ctx, int worker_id, long long begin, long long end) {
+    SensorIndex *index = (SensorIndex *)ctx;
+    const SensorColumns *columns = index->columns;
+    (void)worker_id;
+
+    for (long long b = begin; b < end; b++) {
+        long long first = b * INDEX_BLOCK;
+        long long last = first + INDEX_BLOCK < columns->count ? first + INDEX_BLOCK : columns->count;
+        uint16_t low = UINT16_MAX, high = 0;
+        uint32_t types = 0, sectors = 0;
+
+        for (long long i = first; i < last; i++) {
+            uint64_t bit = 1ULL << (i & 63);
+            unsigned type = columns->types[i];
+            unsigned sector = columns->sectors[i] - 1u;
+            if (type >= NUM_SENSOR_TYPES || sector >= NUM_SECTORS) {
+                continue;
+            }
+            index->type_bitmaps[type][i >> 6] |= bit;
+            index->sector_bitmaps[sector][i >> 6] |= bit;
+            types |= 1u << type;
+            sectors |= 1u << sector;
+            if (columns->values[i] < low) {
+                low = columns->values[i];
+            }
+            if (columns->values[i] > high) {
+                high = columns->values[i];
+            }
+        }
+        index->block_min[b] = low;
+        index->block_max[b] = high;
+        index->block_types[b] = types;
+        index->block_sectors[b] = sectors;
+    }
+}
+
+// Function to build the zone maps and bitmap indexes for 'columns' in parallel
+int index_build(ThreadPool *pool, int active, const SensorColumns *columns, long long chunk_size,
+                SensorIndex *index) {
+    memset(index, 0, sizeof(*index));
+    index->columns = columns;
+    index->num_blocks = (columns->count + INDEX_BLOCK - 1) / INDEX_BLOCK;
+
+    size_t words = index->num_blocks * INDEX_WORDS;
+    int failed = 0;
+    index->block_min = (uint16_t *)malloc(index->num_blocks * sizeof(uint16_t));
+    index->block_max = (uint16_t *)malloc(index->num_blocks * sizeof(uint16_t));
+    index->block_types = (uint32_t *)malloc(index->num_blocks * sizeof(uint32_t));
+    index->block_sectors = (uint32_t *)malloc(index->num_blocks * sizeof(uint32_t));
+    failed |= !index->block_min || !index->block_max || !index->block_types || !index->block_sectors;
+    for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+        index->type_bitmaps[t] = (uint64_t *)calloc(words, sizeof(uint64_t));
+        failed |= index->type_bitmaps[t] == NULL;
+    }
+    for (int s = 0; s < NUM_SECTORS; s++) {
+        index->sector_bitmaps[s] = (uint64_t *)calloc(words, sizeof(uint64_t));
+        failed |= index->sector_bitmaps[s] == NULL;
+    }
+    if (failed) {
+        index_free(index);
+        return -1;
+    }
+
+    long long blocks_per_chunk = chunk_size / INDEX_BLOCK > 0 ? chunk_size / INDEX_BLOCK : 1;
+    pool_run(pool, active, index->num_blocks, blocks_per_chunk, index_blocks, NULL, index);
+    return 0;
+}
+
+// Function to map reading 'i' to its result group
+static inline int query_group(const SensorColumns *columns, const SensorQuery *query, long long i) {
+    switch (query->group_by) {
+        case GROUP_BY_TYPE: return columns->types[i];
+        case GROUP_BY_SECTOR: return columns->sectors[i] - 1;
+        default: return 0;
+    }
+}
+
+// Function to fold one matching reading into a result group
+static inline void query_accumulate(QueryAggregate *group, uint16_t value) {
+    if (group->count == 0 || value < group->min) {
+        group->min = value;
+    }
+    if (group->count == 0 || value > group->max) {
+        group->max = value;
+    }
+    group->count++;
+    group->sum += value;
+}
+
+// Pool task to evaluate the query over blocks [begin, end)
+void query_blocks(void *ctx, int worker_id, long long begin, long long end) {
+    const QueryJob *job = (const QueryJob *)ctx;
+    const SensorIndex *index = job->index;
+    const SensorQuery *query = job->query;
+    const SensorColumns *columns = index->columns;
+    QueryPartial *partial = &job->partials[worker_id];
+
+    for (long long b = begin; b < end; b++) {
+        // Zone map and presence bits: skip blocks that cannot match
+        if (index->block_max[b] < query->value_min || index->block_min[b] > query->value_max ||
+            (index->block_types[b] & query->type_mask) == 0 ||
+            (index->block_sectors[b] & query->sector_mask) == 0) {
+            partial->blocks_skipped++;
+            continue;
+        }
+        partial->blocks_scanned++;
+
+        // The value predicate is a no-op when the whole block is in range
+        int check_values = index->block_min[b] < query->value_min || index->block_max[b] > query->value_max;
+
+        for (long long w = b * INDEX_WORDS; w < (b + 1) * INDEX_WORDS; w++) {
+            long long base = w * 64;
+            if (base >= columns->count) {
+                break;
+            }
+            uint64_t types = 0, sectors = 0;
+            for (int t = 0; t < NUM_SENSOR_TYPES; t++) {
+                if (query->type_mask & (1u << t)) {
+                    types |= index->type_bitmaps[t][w];
+                }
+            }
+            if (types == 0) {
+                continue;
+            }
+            for (int s = 0; s < NUM_SECTORS; s++) {
+                if (query->sector_mask & (1u << s)) {
+                    sectors |= index->sector_bitmaps[s][w];
+                }
+            }
+            uint64_t match = types & sectors;
+            if (match != 0 && check_values) {
+                int rows = columns->count - base < 64 ? (int)(columns->count - base) : 64;
+                match &= range_mask_kernel(columns->values + base, rows, query->value_min, query->value_max);
+            }
+
+            while (match != 0) {
+                long long i = base + __builtin_ctzll(match);
+                query_accumulate(&partial->groups[query_group(columns, query, i)], columns->values[i]);
+                match &= match - 1;
+            }
+        }
+    }
+}
+
+// Function to merge one result group into another
+static void merge_query_aggregate(QueryAggregate *into, const QueryAggregate *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->count == 0 || from->min < into->min) {
+        into->min = from->min;
+    }
+    if (into->count == 0 || from->max > into->max) {
+        into->max = from->max;
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+}
+
+// Function to run a query on 'active' workers using the index
+int run_indexed_query(ThreadPool *pool, int active, const SensorIndex *index, const SensorQuery *query,
+                      long long chunk_size, QueryPartial *result) {
+    QueryPartial *partials = (QueryPartial *)aligned_alloc(CACHE_LINE_SIZE, active * sizeof(QueryPartial));
+    if (partials == NULL) {
+        return -1;
+    }
+    memset(partials, 0, active * sizeof(QueryPartial));
+
+    QueryJob job = {index, query, partials};
+    long long blocks_per_chunk = chunk_size / INDEX_BLOCK > 0 ? chunk_size / INDEX_BLOCK : 1;
+    pool_run(pool, active, index->num_blocks, blocks_per_chunk, query_blocks, NULL, &job);
+
+    memset(result, 0, sizeof(*result));
+    for (int w = 0; w < active; w++) {
+        for (int g = 0; g < NUM_SECTORS; g++) {
+            merge_query_aggregate(&result->groups[g], &partials[w].groups[g]);
+        }
+        result->blocks_scanned += partials[w].blocks_scanned;
+        result->blocks_skipped += partials[w].blocks_skipped;
+    }
+    free(partials);
+    return 0;
+}
+
+// Reference evaluation: test every reading, single-threaded, no index
+void run_full_scan_query(const SensorColumns *columns, const SensorQuery *query, QueryPartial *result) {
+    memset(result, 0, sizeof(*result));
+    for (long long i = 0; i < columns->count; i++) {
+        unsigned type = columns->types[i];
+        unsigned sector = columns->sectors[i] - 1u;
+        uint16_t value = columns->values[i];
+        if (type < NUM_SENSOR_TYPES && sector < NUM_SECTORS &&
+            (query->type_mask & (1u << type)) && (query->sector_mask & (1u << sector)) &&
+            value >= query->value_min && value <= query->value_max) {
+            query_accumulate(&result->groups[query_group(columns, query, i)], value);
+        }
+    }
+}
+
+// Function to parse a numeric condition ("=A", "=A-B", ">A", ">=A", "<A",
+// "<=A") into the inclusive range [*low, *high], narrowing what is there
+static int parse_range_condition(const char *op, long long *low, long long *high) {
+    char *end;
+    if (op[0] == '=') {
+        long long a = strtoll(op + 1, &end, 10);
+        long long b = a;
+        if (*end == '-') {
+            b = strtoll(end + 1, &end, 10);
+        }
+        if (end == op + 1 || *end != '\0') {
+            return -1;
+        }
+        *low = a > *low ? a : *low;
+        *high = b < *high ? b : *high;
+        return 0;
+    }
+    int inclusive = op[1] == '=';
+    long long a = strtoll(op + 1 + inclusive, &end, 10);
+    if (end == op + 1 + inclusive || *end != '\0') {
+        return -1;
+    }
+    if (op[0] == '>') {
+        a += !inclusive;
+        *low = a > *low ? a : *low;
+    } else if (op[0] == '<') {
+        a -= !inclusive;
+        *high = a < *high ? a : *high;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Function to parse a --where filter such as "type=light,sector=3-9,value>800"
+// (types may be listed as soil|temp) and a --group-by of none, type or sector
+int parse_query(const char *where, const char *group_by, SensorQuery *query) {
+    long long sector_low = 1, sector_high = NUM_SECTORS;
+    long long value_low = 0, value_high = UINT16_MAX;
+    query->type_mask = ALL_TYPES;
+    query->group_by = GROUP_NONE;
+
+    char buffer[256];
+    if (strlen(where) >= sizeof(buffer)) {
+        printf("Error: --where filter is too long\n");
+        return -1;
+    }
+    strcpy(buffer, where);
+
+    for (char *term = strtok(buffer, ","); term != NULL; term = strtok(NULL, ",")) {
+        int status = -1;
+        if (strncmp(term, "type=", 5) == 0) {
+            char *save;
+            query->type_mask = 0;
+            status = 0;
+            for (char *name = strtok_r(term + 5, "|", &save); name != NULL; name = strtok_r(NULL, "|", &save)) {
+                int type = parse_sensor_type(name);
+                if (type < 0) {
+                    status = -1;
+                    break;
+                }
+                query->type_mask |= 1u << type;
+            }
+        } else if (strncmp(term, "sector", 6) == 0) {
+            status = parse_range_condition(term + 6, &sector_low, &sector_high);
+        } else if (strncmp(term, "value", 5) == 0) {
+            status = parse_range_condition(term + 5, &value_low, &value_high);
+        }
+        if (status != 0) {
+            printf("Error: cannot parse filter term '%s'\n", term);
+            return -1;
+        }
+    }
+
+    query->sector_mask = 0;
+    for (long long s = sector_low < 1 ? 1 : sector_low; s <= sector_high && s <= NUM_SECTORS; s++) {
+        query->sector_mask |= 1u << (s - 1);
+    }
+    // An empty range matches nothing; keep min > max so every block is skipped
+    query->value_min = (uint16_t)(value_low < 0 ? 0 : value_low > UINT16_MAX ? UINT16_MAX : value_low);
+    query->value_max = (uint16_t)(value_high < 0 ? 0 : value_high > UINT16_MAX ? UINT16_MAX : value_high);
+    if (value_low > value_high || value_high < 0 || value_low > UINT16_MAX) {
+        query->value_min = 1;
+        query->value_max = 0;
+    }
+
+    if (group_by == NULL || strcmp(group_by, "none") == 0) {
+        query->group_by = GROUP_NONE;
+    } else if (strcmp(group_by, "type") == 0) {
+        query->group_by = GROUP_BY_TYPE;
+    } else if (strcmp(group_by, "sector") == 0) {
+        query->group_by = GROUP_BY_SECTOR;
+    } else {
+        printf("Error: --group-by must be none, type or sector\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to print the groups of a query result
+void print_query_result(const SensorQuery *query, const QueryPartial *result) {
+    int groups = query->group_by == GROUP_BY_TYPE ? NUM_SENSOR_TYPES :
+                 query->group_by == GROUP_BY_SECTOR ? NUM_SECTORS : 1;
+
+    printf("%-18s %12s %14s %10s %6s %6s\n", "Group", "Count", "Sum", "Average", "Min", "Max");
+    for (int g = 0; g < groups; g++) {
+        const QueryAggregate *a = &result->groups[g];
+        if (a->count == 0 && query->group_by != GROUP_NONE) {
+            continue;
+        }
+        char label[32];
+        if (query->group_by == GROUP_BY_TYPE) {
+            snprintf(label, sizeof(label), "%s", get_sensor_type_name((SensorType)g));
+        } else if (query->group_by == GROUP_BY_SECTOR) {
+            snprintf(label, sizeof(label), "Sector %d", g + 1);
+        } else {
+            snprintf(label, sizeof(label), "All matches");
+        }
+        if (a->count == 0) {
+            printf("%-18s %12d %14d %10s %6s %6s\n", label, 0, 0, "-", "-", "-");
+        } else {
+            printf("%-18s %12lld %14lld %10.2f %6u %6u\n", label, a->count, a->sum,
+                   (double)a->sum / a->count, a->min, a->max);
+        }
+    }
+}
+
+// Function to index the in-memory dataset, answer the query in parallel,
+// and check the answer against a full single-threaded scan
+int run_query(ThreadPool *pool, int num_threads, long long chunk_size, const SensorQuery *query,
+              const char *where) {
+    SensorIndex index;
+    QueryPartial indexed, scanned;
+
+    printf("\nBuilding zone maps and bitmap indexes (%d readings per block)...\n", INDEX_BLOCK);
+    double build_start = now_seconds();
+    if (index_build(pool, num_threads, &sensor_data, chunk_size, &index) != 0) {
+        printf("Memory allocation failed\n");
+        return 1;
+    }
+    double build_time = now_seconds() - build_start;
+
+    double query_start = now_seconds();
+    if (run_indexed_query(pool, num_threads, &index, query, chunk_size, &indexed) != 0) {
+        printf("Memory allocation failed\n");
+        index_free(&index);
+        return 1;
+    }
+    double query_time = now_seconds() - query_start;
+
+    double scan_start = now_seconds();
+    run_full_scan_query(&sensor_data, query, &scanned);
+    double scan_time = now_seconds() - scan_start;
+
+    printf("\n===== Query: %s =====\n", where);
+    print_query_result(query, &indexed);
+    printf("\nIndex build time: %.4f seconds\n", build_time);
+    printf("Indexed query time (%d threads, %s kernels): %.4f seconds\n", num_threads, kernel_name, query_time);
+    printf("Blocks scanned: %lld, skipped: %lld of %lld\n",
+           indexed.blocks_scanned, indexed.blocks_skipped, index.num_blocks);
+    printf("Full single-threaded scan time: %.4f seconds\n", scan_time);
+
+    int verified = memcmp(indexed.groups, scanned.groups, sizeof(indexed.groups)) == 0;
+    printf(verified ? "Verification successful: indexed and full-scan results match.\n"
+                    : "Verification failed: indexed and full-scan results differ!\n");
+    index_free(&index);
+    return verified ? 0 : 1;
+}
+
+// Function to report sensor data by type from the merged totals
+void analyze_sensor_data_by_type(const GroupTotals *totals) {
+    printf("\n===== Sensor Data Analysis by Type =====\n");
+    for (int i = 0; i < NUM_SENSOR_TYPES; i++) {
+        if (totals->type_counts[i] > 0) {
+            double average = (double)totals->type_sums[i] / totals->type_counts[i];
+            printf("%s: %lld readings, Sum: %lld, Average: %.2f\n", 
+                   get_sensor_type_name((SensorType)i), totals->type_counts[i], totals->type_sums[i], average);
+        }
+    }
+}
+
+// Function to report sensor data by field sector from the merged totals
+void analyze_sensor_data_by_sector(const GroupTotals *totals) {
+    printf("\n===== Sensor Data Analysis by Field Sector =====\n");
+    for (int i = 0; i < NUM_SECTORS; i++) {
+        if (totals->sector_counts[i] > 0) {
+            double average = (double)totals->sector_sums[i] / totals->sector_counts[i];
+            printf("Sector %d: %lld readings, Sum: %lld, Average: %.2f\n", 
+                   i+1, totals->sector_counts[i], totals->sector_sums[i], average);
+        }
+    }
+}
+
+// Function to print the results of an aggregation pass
+void print_aggregation_results(long long readings, int num_threads, long long sum, double seconds) {
+    printf("\n===== Multithreaded Processing Results =====\n");
+    printf("Number of sensor readings (n): %lld\n", readings);
+    printf("Number of threads: %d\n", num_threads);
+    printf("Total sum of sensor values: %lld\n", sum);
+    printf("Multithreaded processing time: %.4f seconds\n", seconds);
+}
+
+// Function to aggregate the in-memory dataset and verify it single-threaded
+int process_in_memory(ThreadPool *pool, int num_threads, long long chunk_size, DistributionSketch *sketch) {
+    printf("\nStarting multithreaded processing with %d threads (%lld readings per chunk, %s kernels)...\n",
+           num_threads, chunk_size, kernel_name);
+    
+    // With --perf, a sum-only pass first separates the cost of streaming the
+    // values from the cost of the type and sector histograms
+    if (perf_session != NULL) {
+        perf_phase_begin(perf_session);
+        run_parallel_sum(pool, num_threads, &sensor_data, chunk_size);
+        perf_phase_end(perf_session, "sum", num_threads, sizeof(uint16_t));
+        perf_phase_begin(perf_session);
+    }
+    
+    // Record start time for multithreaded processing
+    double mt_start_time = now_seconds();
+    
+    // Rolling statistics are folded in by the same pass; later queries
+    // read the buckets, not the readings
+    run_parallel_aggregation(pool, num_threads, &sensor_data, chunk_size, sketch,
+                             sensor_data.timestamps != NULL ? rolling_stats : NULL);
+    
+    // Record end time for multithreaded processing
+    double mt_processing_time = now_seconds() - mt_start_time;
+    
+    if (perf_session != NULL) {
+        perf_phase_end(perf_session, "analyze", num_threads, sizeof(uint16_t) + 2 * sizeof(uint8_t));
+    }
+    
+    print_worker_report(pool, num_threads);
+    
+    // Print the multithreaded result
+    print_aggregation_results(n, num_threads, total_sum, mt_processing_time);
+    
+    // Verify result with a single-threaded calculation
+    printf("\nVerifying with single-threaded processing...\n");
+    
+    // Record start time for single-threaded processing
+    double st_start_time = now_seconds();
+    
+    GroupTotals verification_groups;
+    memset(&verification_groups, 0, sizeof(verification_groups));
+    group_kernel(sensor_data.values, sensor_data.types, sensor_data.sectors, n, &verification_groups);
+    long long verification_sum = sum_kernel(sensor_data.values, n);
+    
+    // Record end time for single-threaded processing
+    double st_processing_time = now_seconds() - st_start_time;
+    
+    printf("Single-threaded sum: %lld\n", verification_sum);
+    printf("Single-threaded processing time: %.4f seconds\n", st_processing_time);
+    
+    // Calculate speedup
+    double speedup = st_processing_time / mt_processing_time;
+    
+    int verified = total_sum == verification_sum &&
+                   memcmp(&total_groups, &verification_groups, sizeof(GroupTotals)) == 0;
+    if (verified) {
+        printf("\nVerification successful: Multithreaded and single-threaded results match.\n");
+        printf("Performance speedup: %.2fx faster with multithreading\n", speedup);
+    } else {
+        printf("\nVerification failed: Results do not match!\n");
+    }
+    
+    // Report the per-type and per-sector results of the same parallel pass
+    analyze_sensor_data_by_type(&total_groups);
+    analyze_sensor_data_by_sector(&total_groups);
+    if (sketch != NULL) {
+        print_percentile_report(sketch);
+    }
+    
+    return verified ? 0 : 1;
+}
+
+// One slot of the streaming ring: a fixed-capacity batch of columns
+typedef struct {
+    SensorColumns columns;
+    long long capacity;
+    int filled;
+} StreamBuffer;
+
+// Bounded ring of batches shared by the loader thread and the aggregator
+typedef struct {
+    int fd;
+    DatasetHeader header;
+    int has_timestamps;
+    long long batch_size;
+    StreamBuffer buffers[STREAM_BUFFERS];
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int error;
+} DatasetStream;
+
+// Function to read exactly 'length' bytes at 'offset', retrying short reads
+int read_fully(int fd, void *buffer, size_t length, uint64_t offset) {
+    char *out = (char *)buffer;
+    while (length > 0) {
+        ssize_t got = pread(fd, out, length, offset);
+        if (got <= 0) {
+            return -1;
+        }
+        out += got;
+        length -= got;
+        offset += got;
+    }
+    return 0;
+}
+
+#define VERIFY_READ_BYTES (1 << 20)   // whole 64-bit words, so only a column's tail is padded
+
+// Function to check the checksum of an open dataset file in constant
+// memory, for the paths that never map all of it. Each column is read and
+// hashed in VERIFY_READ_BYTES pieces; this costs one extra read of the file.
+int verify_dataset_file(int fd, const DatasetHeader *header, const char *path) {
+    const uint64_t offsets[4] = {header->values_offset, header->types_offset, header->sectors_offset,
+                                 header->timestamps_offset};
+    const uint64_t widths[4] = {sizeof(uint16_t), 1, 1, header->version >= 2 ? sizeof(uint32_t) : 0};
+    char *buffer = (char *)malloc(VERIFY_READ_BYTES);
+    if (buffer == NULL) {
+        printf("Memory allocation failed\n");
+        return -1;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int status = 0;
+    for (int c = 0; c < 4 && status == 0; c++) {
+        uint64_t length = header->count * widths[c];
+        for (uint64_t done = 0; done < length && status == 0; done += VERIFY_READ_BYTES) {
+            size_t piece = length - done < VERIFY_READ_BYTES ? length - done : VERIFY_READ_BYTES;
+            status = read_fully(fd, buffer, piece, offsets[c] + done);
+            hash = checksum_update(hash, buffer, piece);
+        }
+    }
+    free(buffer);
+    if (status != 0) {
+        printf("Error: cannot read '%s'\n", path);
+        return -1;
+    }
+    if (hash != header->checksum) {
+        printf("Error: dataset checksum mismatch in '%s'\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to open a dataset file by path and check its header and checksum
+int verify_dataset_path(const char *path) {
+    DatasetHeader header;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || read_fully(fd, &header, sizeof(header), 0) != 0 ||
+        validate_dataset_header(&header, st.st_size) != 0) {
+        printf("Error: '%s' is not a readable sensor dataset\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    int status = verify_dataset_file(fd, &header, path);
+    close(fd);
+    return status;
+}
+
+// Loader thread: fill free ring slots with consecutive batches of the file
+void *stream_loader(void *arg) {
+    DatasetStream *stream = (DatasetStream *)arg;
+    long long total = stream->header.count;
+    long long batches = (total + stream->batch_size - 1) / stream->batch_size;
+
+    for (long long b = 0; b < batches; b++) {
+        StreamBuffer *buffer = &stream->buffers[b % STREAM_BUFFERS];
+
+        pthread_mutex_lock(&stream->lock);
+        while (buffer->filled && !stream->error) {
+            pthread_cond_wait(&stream->changed, &stream->lock);
+        }
+        int stop = stream->error;
+        pthread_mutex_unlock(&stream->lock);
+        if (stop) {
+            break;
+        }
+
+        long long first = b * stream->batch_size;
+        long long count = total - first < stream->batch_size ? total - first : stream->batch_size;
+        int status = read_fully(stream->fd, buffer->columns.values, count * sizeof(uint16_t),
+                                stream->header.values_offset + first * sizeof(uint16_t));
+        status |= read_fully(stream->fd, buffer->columns.types, count, stream->header.types_offset + first);
+        status |= read_fully(stream->fd, buffer->columns.sectors, count, stream->header.sectors_offset + first);
+        if (stream->has_timestamps) {
+            status |= read_fully(stream->fd, buffer->columns.timestamps, count * sizeof(uint32_t),
+                                 stream->header.timestamps_offset + first * sizeof(uint32_t));
+        }
+        buffer->columns.count = count;
+
+        pthread_mutex_lock(&stream->lock);
+        if (status != 0) {
+            stream->error = 1;
+        } else {
+            buffer->filled = 1;
+        }
+        pthread_cond_broadcast(&stream->changed);
+        pthread_mutex_unlock(&stream->lock);
+    }
+    return NULL;
+}
+
+// Function to aggregate a dataset file of any size in constant memory.
+// A loader thread reads batch b+1 (and b+2) while the pool aggregates batch b.
+int process_stream(ThreadPool *pool, int num_threads, long long chunk_size,
+                   const char *path, long long batch_size, int verify, DistributionSketch *sketch) {
+    DatasetStream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    stream.fd = open(path, O_RDONLY);
+    if (stream.fd < 0) {
+        perror("Failed to open dataset file");
+        return 1;
+    }
+    struct stat st;
+    if (fstat(stream.fd, &st) != 0 ||
+        read_fully(stream.fd, &stream.header, sizeof(stream.header), 0) != 0 ||
+        validate_dataset_header(&stream.header, st.st_size) != 0) {
+        printf("Error: '%s' is not a readable sensor dataset\n", path);
+        close(stream.fd);
+        return 1;
+    }
+    posix_fadvise(stream.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    if (verify && verify_dataset_file(stream.fd, &stream.header, path) != 0) {
+        close(stream.fd);
+        return 1;
+    }
+    stream.has_timestamps = stream.header.version >= 2;
+
+    long long total = stream.header.count;
+    stream.batch_size = total < batch_size && total > 0 ? total : batch_size;
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        if (allocate_columns(&stream.buffers[b].columns, stream.batch_size) != 0) {
+            printf("Memory allocation failed\n");
+            for (int k = 0; k < b; k++) {
+                free_columns(&stream.buffers[k].columns);
+            }
+            close(stream.fd);
+            return 1;
+        }
+        stream.buffers[b].capacity = stream.batch_size;
+    }
+    pthread_mutex_init(&stream.lock, NULL);
+    pthread_cond_init(&stream.changed, NULL);
+
+    printf("Streaming sensor dataset '%s': %lld readings in batches of %lld (%d buffers, %.1f MB resident)\n",
+           path, total, stream.batch_size, STREAM_BUFFERS,
+           STREAM_BUFFERS * stream.batch_size * 8.0 / (1024 * 1024));
+    printf("\nStarting multithreaded processing with %d threads (%lld readings per chunk, %s kernels)...\n",
+           num_threads, chunk_size, kernel_name);
+
+    double start_time = now_seconds();
+
+    pthread_t loader;
+    int loader_started = pthread_create(&loader, NULL, stream_loader, &stream) == 0;
+    if (!loader_started) {
+        perror("Failed to create loader thread");
+        stream.error = 1;
+    }
+
+    GroupTotals stream_groups;
+    memset(&stream_groups, 0, sizeof(stream_groups));
+    long long stream_sum = 0;
+    long long processed = 0;
+    long long batches = (total + stream.batch_size - 1) / stream.batch_size;
+
+    for (long long b = 0; b < batches; b++) {
+        StreamBuffer *buffer = &stream.buffers[b % STREAM_BUFFERS];
+
+        pthread_mutex_lock(&stream.lock);
+        while (!buffer->filled && !stream.error) {
+            pthread_cond_wait(&stream.changed, &stream.lock);
+        }
+        pthread_mutex_unlock(&stream.lock);
+        if (!buffer->filled) {
+            break;
+        }
+
+        stream_sum += run_parallel_aggregation(pool, num_threads, &buffer->columns, chunk_size, sketch,
+                                               stream.has_timestamps ? rolling_stats : NULL);
+        merge_group_totals(&stream_groups, &total_groups);
+        processed += buffer->columns.count;
+
+        // Hand the slot back to the loader
+        pthread_mutex_lock(&stream.lock);
+        buffer->filled = 0;
+        pthread_cond_broadcast(&stream.changed);
+        pthread_mutex_unlock(&stream.lock);
+    }
+
+    // Wake the loader if it is waiting on a slot we will never release
+    pthread_mutex_lock(&stream.lock);
+    if (processed != total) {
+        stream.error = 1;
+    }
+    pthread_cond_broadcast(&stream.changed);
+    pthread_mutex_unlock(&stream.lock);
+    if (loader_started) {
+        pthread_join(loader, NULL);
+    }
+
+    double seconds = now_seconds() - start_time;
+
+    int status = 0;
+    if (processed != total) {
+        printf("Error: failed to read '%s' after %lld of %lld readings\n", path, processed, total);
+        status = 1;
+    } else {
+        total_sum = stream_sum;
+        total_groups = stream_groups;
+        print_aggregation_results(processed, num_threads, stream_sum, seconds);
+        printf("Batches processed: %lld\n", batches);
+        if (page_mode != PAGES_DEFAULT) {
+            print_page_backing("Batch buffer", &stream.buffers[0].columns);
+        }
+        analyze_sensor_data_by_type(&stream_groups);
+        analyze_sensor_data_by_sector(&stream_groups);
+        if (sketch != NULL) {
+            print_percentile_report(sketch);
+        }
+    }
+
+    for (int b = 0; b < STREAM_BUFFERS; b++) {
+        free_columns(&stream.buffers[b].columns);
+    }
+    pthread_mutex_destroy(&stream.lock);
+    pthread_cond_destroy(&stream.changed);
+    close(stream.fd);
+    return status;
+}
+
+// Multi-file ingest. Many per-gateway dataset files are read through one
+// I/O thread that keeps up to 'depth' reads in flight (io_uring, driven by
+// raw syscalls, or synchronous pread where io_uring is unavailable). Files
+// are cut into batches; each batch is read straight into one of
+// INGEST_SLOTS column buffers, and completed slots are handed to the pool
+// while the next ones are still on their way from disk.
+#define INGEST_SLOTS 8
+#define INGEST_READ_BYTES (256 * 1024)  // column reads are split into pieces of this size
+#define INGEST_LOOKAHEAD 32             // files whose headers are read ahead of the cursor
+
+#ifdef HAVE_IO_URING
+// Submission and completion rings shared with the kernel
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size;
+    unsigned pending;           // queued SQEs not yet passed to io_uring_enter
+} IoRing;
+
+// Function to create an io_uring instance and map its rings
+int io_ring_init(IoRing *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    if (ring->sq_ring != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+    }
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, params.sq_entries * sizeof(struct io_uring_sqe));
+        }
+        close(ring->fd);
+        return -1;
+    }
+
+    char *sq = (char *)ring->sq_ring;
+    char *cq = (char *)ring->cq_ring;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return 0;
+}
+
+// Function to unmap the rings and close the io_uring instance
+void io_ring_free(IoRing *ring) {
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+// Function to queue a vectored read; the caller keeps 'iov' alive until it completes
+void io_ring_queue_read(IoRing *ring, int fd, const struct iovec *iov, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    // READV rather than READ so kernels from 5.1 on are supported
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)iov;
+    sqe->len = 1;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+}
+
+// Function to submit the queued reads and wait for at least 'wait' completions
+int io_ring_submit(IoRing *ring, unsigned wait) {
+    while (1) {
+        long ret = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait,
+                           wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0) {
+            ring->pending -= (unsigned)ret;
+            return 0;
+        }
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+}
+
+// Function to take the next completion off the ring; returns 0 if there is none
+int io_ring_reap(IoRing *ring, uint64_t *user_data, int *result) {
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    *user_data = cqe->user_data;
+    *result = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+#endif
+
+enum {
+    INGEST_FILE_CLOSED,         // header not requested yet
+    INGEST_FILE_HEADER,         // header read in flight
+    INGEST_FILE_OPEN,           // header valid; batches being read
+    INGEST_FILE_FAILED
+};
+
+enum {
+    INGEST_SLOT_FREE,
+    INGEST_SLOT_READING,
+    INGEST_SLOT_READY
+};
+
+// One input file and how far it has been read
+typedef struct {
+    char *path;
+    int fd;
+    int state;
+    uint64_t size;
+    DatasetHeader header;
+    long long next;             // first reading not yet assigned to a slot
+    int reads_in_flight;
+} IngestFile;
+
+// One batch buffer; reads land here and the pool aggregates it in place.
+// Small files are packed back to back, so one pass may cover many files.
+typedef struct {
+    SensorColumns columns;
+    int has_timestamps;         // files with and without timestamps never share a slot
+    int reads_left;             // issued pieces not yet completed
+    int issued;                 // every piece of the batch has been issued
+    int failed_file;            // a file whose read failed, or -1
+} IngestSlot;
+
+// One read in flight: a file header or a piece of a column
+typedef struct {
+    int slot;                   // -1 for a header read
+    int file;
+    struct iovec iov;
+    uint64_t offset;
+} IngestRead;
+
+typedef struct {
+    IngestFile *files;
+    int num_files;
+    long long batch_size;
+    int depth;
+    IngestSlot slots[INGEST_SLOTS];
+    int slot_state[INGEST_SLOTS];
+    int ready[INGEST_SLOTS];    // FIFO of READY slots for the aggregator
+    int ready_head;
+    int ready_count;
+    int finished;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+
+    // Owned by the I/O thread
+    int next_header;            // next file whose header is requested
+    int cursor;                 // file whose readings are being assigned
+    int fill_slot;              // slot being filled, or -1
+    int fill_file;              // file whose part is being issued, or -1
+    long long fill_first;
+    long long fill_count;
+    long long fill_at;          // where the part starts in the slot
+    int fill_column;
+    uint64_t fill_done;         // bytes of the current column already issued
+    long long reads_issued;
+    long long bytes_read;
+    int peak_in_flight;
+    int files_failed;
+    int use_uring;
+    int io_failed;
+} IngestState;
+
+// Function to close a file once nothing more will be read from it
+static void ingest_release_file(IngestState *s, int f) {
+    IngestFile *file = &s->files[f];
+    if (file->fd >= 0 && file->reads_in_flight == 0 && s->fill_file != f &&
+        (file->state == INGEST_FILE_FAILED || file->next >= (long long)file->header.count)) {
+        close(file->fd);
+        file->fd = -1;
+    }
+}
+
+// Function to hand a fully read slot to the aggregator
+static void ingest_slot_check(IngestState *s, int slot_index) {
+    IngestSlot *slot = &s->slots[slot_index];
+    if (!slot->issued || slot->reads_left > 0) {
+        return;
+    }
+    pthread_mutex_lock(&s->lock);
+    s->slot_state[slot_index] = INGEST_SLOT_READY;
+    s->ready[(s->ready_head + s->ready_count) % INGEST_SLOTS] = slot_index;
+    s->ready_count++;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+// Function to locate column 'column' of the part being filled: where it
+// goes in the slot, where it starts in the file and how long it is.
+// Returns 0 if the file has no such column.
+static int ingest_column(IngestState *s, int column, char **dest, uint64_t *offset, uint64_t *length) {
+    IngestSlot *slot = &s->slots[s->fill_slot];
+    const DatasetHeader *header = &s->files[s->fill_file].header;
+    uint64_t first = s->fill_first;
+    uint64_t count = s->fill_count;
+    uint64_t at = s->fill_at;
+
+    switch (column) {
+        case 0:
+            *dest = (char *)(slot->columns.values + at);
+            *offset = header->values_offset + first * sizeof(uint16_t);
+            *length = count * sizeof(uint16_t);
+            return 1;
+        case 1:
+            *dest = (char *)(slot->columns.types + at);
+            *offset = header->types_offset + first;
+            *length = count;
+            return 1;
+        case 2:
+            *dest = (char *)(slot->columns.sectors + at);
+            *offset = header->sectors_offset + first;
+            *length = count;
+            return 1;
+        case 3:
+            *dest = (char *)(slot->columns.timestamps + at);
+            *offset = header->timestamps_offset + first * sizeof(uint32_t);
+            *length = count * sizeof(uint32_t);
+            return header->version >= 2;
+    }
+    return 0;
+}
+
+// Function to pick the next read to issue. Returns 1 with 'read' filled in,
+// 0 if nothing can be issued until a read completes or a slot is freed, and
+// -1 once every file has been fully requested.
+static int ingest_next_read(IngestState *s, IngestRead *read) {
+    // Header reads for the files just ahead of the cursor come first, so the
+    // readings of the next file can follow the current one without a gap
+    while (s->next_header < s->num_files && s->next_header < s->cursor + INGEST_LOOKAHEAD) {
+        int f = s->next_header++;
+        IngestFile *file = &s->files[f];
+        struct stat st;
+        file->fd = open(file->path, O_RDONLY);
+        if (file->fd < 0 || fstat(file->fd, &st) != 0) {
+            printf("Error: cannot open '%s': %s\n", file->path, strerror(errno));
+            if (file->fd >= 0) {
+                close(file->fd);
+                file->fd = -1;
+            }
+            file->state = INGEST_FILE_FAILED;
+            s->files_failed++;
+            continue;
+        }
+        posix_fadvise(file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        file->size = st.st_size;
+        file->state = INGEST_FILE_HEADER;
+        file->reads_in_flight++;
+        read->slot = -1;
+        read->file = f;
+        read->iov.iov_base = &file->header;
+        read->iov.iov_len = sizeof(file->header);
+        read->offset = 0;
+        return 1;
+    }
+
+    char *dest = NULL;
+    uint64_t offset = 0, length = 0;
+    while (s->fill_slot < 0 || s->fill_column == 4) {
+        // Skip files that are finished or unreadable
+        while (s->cursor < s->num_files &&
+               (s->files[s->cursor].state == INGEST_FILE_FAILED ||
+                (s->files[s->cursor].state == INGEST_FILE_OPEN &&
+                 s->files[s->cursor].next >= (long long)s->files[s->cursor].header.count))) {
+            s->cursor++;
+        }
+        IngestFile *file = s->cursor < s->num_files ? &s->files[s->cursor] : NULL;
+        int file_ready = file != NULL && file->state == INGEST_FILE_OPEN;
+
+        if (s->fill_slot >= 0) {
+            // The last part is fully issued. Pack the next file into the same
+            // slot if it is ready and fits; otherwise the slot is complete.
+            IngestSlot *slot = &s->slots[s->fill_slot];
+            if (!file_ready || slot->columns.count == s->batch_size ||
+                (file->header.version >= 2) != slot->has_timestamps) {
+                int index = s->fill_slot;
+                slot->issued = 1;
+                s->fill_slot = -1;
+                ingest_slot_check(s, index);
+                continue;
+            }
+        } else {
+            if (file == NULL) {
+                return -1;
+            }
+            if (!file_ready) {
+                return 0;       // its header is still on the way
+            }
+            int free_slot = -1;
+            pthread_mutex_lock(&s->lock);
+            for (int k = 0; k < INGEST_SLOTS && free_slot < 0; k++) {
+                if (s->slot_state[k] == INGEST_SLOT_FREE) {
+                    free_slot = k;
+                    s->slot_state[k] = INGEST_SLOT_READING;
+                }
+            }
+            pthread_mutex_unlock(&s->lock);
+            if (free_slot < 0) {
+                return 0;
+            }
+            IngestSlot *slot = &s->slots[free_slot];
+            slot->columns.count = 0;
+            slot->has_timestamps = file->header.version >= 2;
+            slot->reads_left = 0;
+            slot->issued = 0;
+            slot->failed_file = -1;
+            s->fill_slot = free_slot;
+        }
+
+        // Start the next part: as much of the file as the slot has room for
+        IngestSlot *slot = &s->slots[s->fill_slot];
+        long long remaining = (long long)file->header.count - file->next;
+        long long room = s->batch_size - slot->columns.count;
+        s->fill_file = s->cursor;
+        s->fill_first = file->next;
+        s->fill_count = remaining < room ? remaining : room;
+        s->fill_at = slot->columns.count;
+        s->fill_column = 0;
+        s->fill_done = 0;
+        slot->columns.count += s->fill_count;
+        file->next += s->fill_count;
+    }
+
+    // Parts are never empty, so this stops at a column with bytes left,
+    // or at 4 once the part is done
+    while (s->fill_column < 4 &&
+           (!ingest_column(s, s->fill_column, &dest, &offset, &length) || s->fill_done >= length)) {
+        s->fill_column++;
+        s->fill_done = 0;
+    }
+    if (s->fill_column == 4) {
+        int f = s->fill_file;
+        s->fill_file = -1;
+        ingest_release_file(s, f);
+        return ingest_next_read(s, read);
+    }
+
+    IngestSlot *slot = &s->slots[s->fill_slot];
+    uint64_t piece = length - s->fill_done < INGEST_READ_BYTES ? length - s->fill_done : INGEST_READ_BYTES;
+    read->slot = s->fill_slot;
+    read->file = s->fill_file;
+    read->iov.iov_base = dest + s->fill_done;
+    read->iov.iov_len = piece;
+    read->offset = offset + s->fill_done;
+    s->fill_done += piece;
+    slot->reads_left++;
+    s->files[s->fill_file].reads_in_flight++;
+    return 1;
+}
+
+// Function to account for a finished read. 'result' is the byte count or a
+// negative errno. Returns 1 if the read was short and must be reissued for
+// the rest, which 'read' then describes.
+static int ingest_complete(IngestState *s, IngestRead *read, int result) {
+    IngestFile *file = &s->files[read->file];
+    if (result > 0 && (size_t)result < read->iov.iov_len) {
+        s->bytes_read += result;
+        read->iov.iov_base = (char *)read->iov.iov_base + result;
+        read->iov.iov_len -= result;
+        read->offset += result;
+        return 1;
+    }
+    int ok = result > 0 && (size_t)result == read->iov.iov_len;
+    if (ok) {
+        s->bytes_read += result;
+    }
+    file->reads_in_flight--;
+
+    if (read->slot < 0) {
+        if (!ok || validate_dataset_header(&file->header, file->size) != 0) {
+            printf("Error: skipping '%s': %s\n", file->path, ok ? "invalid sensor dataset" : "read failed");
+            file->state = INGEST_FILE_FAILED;
+            s->files_failed++;
+        } else {
+            file->state = INGEST_FILE_OPEN;
+        }
+        ingest_release_file(s, read->file);
+        return 0;
+    }
+
+    IngestSlot *slot = &s->slots[read->slot];
+    if (!ok) {
+        slot->failed_file = read->file;
+    }
+    slot->reads_left--;
+    ingest_release_file(s, read->file);
+    ingest_slot_check(s, read->slot);
+    return 0;
+}
+
+// Function to wait until the aggregator frees a slot
+static void ingest_wait_for_slot(IngestState *s) {
+    pthread_mutex_lock(&s->lock);
+    while (1) {
+        int any_free = 0;
+        for (int k = 0; k < INGEST_SLOTS; k++) {
+            any_free |= s->slot_state[k] == INGEST_SLOT_FREE;
+        }
+        if (any_free) {
+            break;
+        }
+        pthread_cond_wait(&s->changed, &s->lock);
+    }
+    pthread_mutex_unlock(&s->lock);
+}
+
+#ifdef HAVE_IO_URING
+// I/O loop on io_uring: keep the queue as full as 'depth' allows, then
+// sleep in the kernel until at least one read completes. Returns 1 if
+// io_uring is unavailable, before anything was read.
+static int ingest_uring_loop(IngestState *s) {
+    IoRing ring;
+    if (io_ring_init(&ring, s->depth) != 0) {
+        return 1;
+    }
+    IngestRead *reads = (IngestRead *)malloc(ring.entries * sizeof(IngestRead));
+    int *free_reads = (int *)malloc(ring.entries * sizeof(int));
+    if (reads == NULL || free_reads == NULL) {
+        free(reads);
+        free(free_reads);
+        io_ring_free(&ring);
+        return 1;
+    }
+    int depth = s->depth < (int)ring.entries ? s->depth : (int)ring.entries;
+    int num_free = depth;
+    for (int k = 0; k < depth; k++) {
+        free_reads[k] = k;
+    }
+
+    int in_flight = 0;
+    int exhausted = 0;
+    int status = 0;
+    while (status == 0) {
+        int more = 0;
+        while (!exhausted && num_free > 0) {
+            IngestRead *read = &reads[free_reads[num_free - 1]];
+            more = ingest_next_read(s, read);
+            if (more <= 0) {
+                exhausted = more < 0;
+                break;
+            }
+            num_free--;
+            io_ring_queue_read(&ring, s->files[read->file].fd, &read->iov, read->offset,
+                               (uint64_t)(read - reads));
+            in_flight++;
+            s->reads_issued++;
+        }
+        if (in_flight > s->peak_in_flight) {
+            s->peak_in_flight = in_flight;
+        }
+        if (in_flight == 0) {
+            if (exhausted) {
+                break;
+            }
+            // Nothing on the way from disk: every slot is waiting to be aggregated
+            ingest_wait_for_slot(s);
+            continue;
+        }
+
+        if (io_ring_submit(&ring, 1) != 0) {
+            perror("io_uring_enter");
+            status = -1;
+            break;
+        }
+        uint64_t user_data;
+        int result;
+        while (io_ring_reap(&ring, &user_data, &result)) {
+            IngestRead *read = &reads[user_data];
+            if (ingest_complete(s, read, result)) {
+                io_ring_queue_read(&ring, s->files[read->file].fd, &read->iov, read->offset, user_data);
+                s->reads_issued++;
+            } else {
+                free_reads[num_free++] = (int)user_data;
+                in_flight--;
+            }
+        }
+    }
+
+    free(reads);
+    free(free_reads);
+    io_ring_free(&ring);
+    return status;
+}
+#endif
+
+// I/O loop without io_uring: one synchronous pread at a time. Regular
+// files are always "ready" to epoll, so there is nothing to multiplex;
+// disk and CPU still overlap because this runs beside the pool.
+static void ingest_pread_loop(IngestState *s) {
+    IngestRead read;
+    int more;
+    while ((more = ingest_next_read(s, &read)) >= 0) {
+        if (more == 0) {
+            ingest_wait_for_slot(s);
+            continue;
+        }
+        s->reads_issued++;
+        s->peak_in_flight = 1;
+        int result = read_fully(s->files[read.file].fd, read.iov.iov_base, read.iov.iov_len, read.offset) == 0
+                     ? (int)read.iov.iov_len : -EIO;
+        ingest_complete(s, &read, result);
+    }
+}
+
+// I/O thread: read every file, then tell the aggregator there is no more
+void *ingest_io_main(void *arg) {
+    IngestState *s = (IngestState *)arg;
+#ifdef HAVE_IO_URING
+    int status = s->use_uring ? ingest_uring_loop(s) : 1;
+    if (status < 0) {
+        s->io_failed = 1;
+    } else if (status > 0 && s->use_uring) {
+        printf("Warning: io_uring is not available here; falling back to pread\n");
+    }
+    s->use_uring = status == 0;
+#else
+    s->use_uring = 0;
+#endif
+    if (!s->use_uring && !s->io_failed) {
+        ingest_pread_loop(s);
+    }
+    pthread_mutex_lock(&s->lock);
+    s->finished = 1;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static int compare_strings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Function to append a path to a growable list
+static int add_ingest_path(char ***paths, int *count, int *capacity, const char *path) {
+    if (*count == *capacity) {
+        int grown = *capacity > 0 ? *capacity * 2 : 64;
+        char **bigger = (char **)realloc(*paths, grown * sizeof(char *));
+        if (bigger == NULL) {
+            return -1;
+        }
+        *paths = bigger;
+        *capacity = grown;
+    }
+    (*paths)[*count] = strdup(path);
+    return (*paths)[(*count)++] == NULL ? -1 : 0;
+}
+
+// Function to expand an ingest source into file paths: the regular files of
+// a directory (sorted by name), or the lines of a list file given as @FILE
+int list_ingest_files(const char *source, char ***paths, int *count) {
+    int capacity = 0;
+    char path[PATH_MAX];
+    *paths = NULL;
+    *count = 0;
+
+    if (source[0] == '@') {
+        FILE *list = fopen(source + 1, "r");
+        if (list == NULL) {
+            perror("Failed to open file list");
+            return -1;
+        }
+        while (fgets(path, sizeof(path), list) != NULL) {
+            path[strcspn(path, "\r\n")] = '\0';
+            if (path[0] != '\0' && path[0] != '#' && add_ingest_path(paths, count, &capacity, path) != 0) {
+                fclose(list);
+                return -1;
+            }
+        }
+        fclose(list);
+        return 0;
+    }
+
+    DIR *dir = opendir(source);
+    if (dir == NULL) {
+        perror("Failed to open ingest directory");
+        return -1;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        if (entry->d_name[0] == '.' ||
+            snprintf(path, sizeof(path), "%s/%s", source, entry->d_name) >= (int)sizeof(path) ||
+            stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        if (add_ingest_path(paths, count, &capacity, path) != 0) {
+            closedir(dir);
+            return -1;
+        }
+    }
+    closedir(dir);
+    if (*count > 1) {
+        qsort(*paths, *count, sizeof(char *), compare_strings);
+    }
+    return 0;
+}
+
+// Function to aggregate many dataset files with reads overlapped across
+// files and with aggregation. 'source' is a directory or @LIST.
+int process_ingest(ThreadPool *pool, int num_threads, long long chunk_size, const char *source,
+                   long long batch_size, int depth, int use_uring, int verify, DistributionSketch *sketch) {
+    IngestState s;
+    memset(&s, 0, sizeof(s));
+    char **paths;
+    if (list_ingest_files(source, &paths, &s.num_files) != 0) {
+        printf("Error: cannot list ingest source '%s'\n", source);
+        for (int f = 0; f < s.num_files; f++) {
+            free(paths[f]);
+        }
+        free(paths);
+        return 1;
+    }
+    if (s.num_files == 0) {
+        printf("Error: no files to ingest in '%s'\n", source);
+        free(paths);
+        return 1;
+    }
+    // Every file is checked before the first batch, so a bad one fails the
+    // run instead of being skipped with part of the totals already counted
+    for (int f = 0; f < s.num_files && verify; f++) {
+        if (verify_dataset_path(paths[f]) != 0) {
+            for (int k = 0; k < s.num_files; k++) {
+                free(paths[k]);
+            }
+            free(paths);
+            return 1;
+        }
+    }
+
+    s.files = (IngestFile *)calloc(s.num_files, sizeof(IngestFile));
+    int status = s.files == NULL;
+    for (int f = 0; f < s.num_files && s.files != NULL; f++) {
+        s.files[f].path = paths[f];
+        s.files[f].fd = -1;
+    }
+    s.batch_size = batch_size;
+    s.depth = depth;
+    s.fill_slot = -1;
+    s.fill_file = -1;
+    s.use_uring = use_uring;
+    for (int k = 0; k < INGEST_SLOTS && status == 0; k++) {
+        status = allocate_columns(&s.slots[k].columns, batch_size) != 0;
+    }
+    if (status != 0) {
+        printf("Memory allocation failed\n");
+    } else {
+        pthread_mutex_init(&s.lock, NULL);
+        pthread_cond_init(&s.changed, NULL);
+
+        printf("Ingesting %d sensor dataset files from '%s' in batches of %lld (%d buffers, %.1f MB resident)\n",
+               s.num_files, source, batch_size, INGEST_SLOTS, INGEST_SLOTS * batch_size * 8.0 / (1024 * 1024));
+        printf("\nStarting multithreaded processing with %d threads (%lld readings per chunk, %s kernels)...\n",
+               num_threads, chunk_size, kernel_name);
+
+        double start_time = now_seconds();
+        pthread_t io_thread;
+        if (pthread_create(&io_thread, NULL, ingest_io_main, &s) != 0) {
+            perror("Failed to create I/O thread");
+            status = 1;
+        }
+
+        GroupTotals ingest_groups;
+        memset(&ingest_groups, 0, sizeof(ingest_groups));
+        long long ingest_sum = 0;
+        long long processed = 0;
+        long long batches = 0;
+        int batches_failed = 0;
+        double wait_time = 0;
+
+        while (status == 0) {
+            double wait_start = now_seconds();
+            pthread_mutex_lock(&s.lock);
+            while (s.ready_count == 0 && !s.finished) {
+                pthread_cond_wait(&s.changed, &s.lock);
+            }
+            int slot_index = -1;
+            if (s.ready_count > 0) {
+                slot_index = s.ready[s.ready_head];
+                s.ready_head = (s.ready_head + 1) % INGEST_SLOTS;
+                s.ready_count--;
+            }
+            pthread_mutex_unlock(&s.lock);
+            wait_time += now_seconds() - wait_start;
+            if (slot_index < 0) {
+                break;
+            }
+
+            IngestSlot *slot = &s.slots[slot_index];
+            if (slot->failed_file >= 0) {
+                printf("Error: read failed in '%s'; a batch of %lld readings is missing\n",
+                       s.files[slot->failed_file].path, slot->columns.count);
+                batches_failed++;
+            } else {
+                ingest_sum += run_parallel_aggregation(pool, num_threads, &slot->columns, chunk_size, sketch,
+                                                       slot->has_timestamps ? rolling_stats : NULL);
+                merge_group_totals(&ingest_groups, &total_groups);
+                processed += slot->columns.count;
+                batches++;
+            }
+
+            // Hand the slot back to the I/O thread
+            pthread_mutex_lock(&s.lock);
+            s.slot_state[slot_index] = INGEST_SLOT_FREE;
+            pthread_cond_broadcast(&s.changed);
+            pthread_mutex_unlock(&s.lock);
+        }
+        if (status == 0) {
+            pthread_join(io_thread, NULL);
+        }
+        double seconds = now_seconds() - start_time;
+
+        if (status == 0 && !s.io_failed) {
+            total_sum = ingest_sum;
+            total_groups = ingest_groups;
+            print_aggregation_results(processed, num_threads, ingest_sum, seconds);
+            printf("Files ingested: %d of %d, batches: %lld\n", s.num_files - s.files_failed, s.num_files,
+                   batches);
+            printf("I/O: %s, %lld reads (peak %d in flight), %.1f MB at %.2f GB/s\n",
+                   s.use_uring ? "io_uring" : "pread", s.reads_issued, s.peak_in_flight,
+                   s.bytes_read / (1024.0 * 1024.0), s.bytes_read / seconds / 1e9);
+            printf("Aggregator waited on I/O for %.4f of %.4f seconds\n", wait_time, seconds);
+            if (page_mode != PAGES_DEFAULT) {
+                print_page_backing("Slot buffer", &s.slots[0].columns);
+            }
+            analyze_sensor_data_by_type(&ingest_groups);
+            analyze_sensor_data_by_sector(&ingest_groups);
+            if (sketch != NULL) {
+                print_percentile_report(sketch);
+            }
+            status = s.files_failed > 0 || batches_failed > 0;
+        }
+        if (s.io_failed) {
+            printf("Error: I/O failed after %lld readings; results are incomplete\n", processed);
+            status = 1;
+        }
+        pthread_mutex_destroy(&s.lock);
+        pthread_cond_destroy(&s.changed);
+    }
+
+    for (int k = 0; k < INGEST_SLOTS; k++) {
+        free_columns(&s.slots[k].columns);
+    }
+    for (int f = 0; f < s.num_files; f++) {
+        if (s.files != NULL && s.files[f].fd >= 0) {
+            close(s.files[f].fd);
+        }
+        free(paths[f]);
+    }
+    free(paths);
+    free(s.files);
+    return status;
+}
+
+typedef struct {
+    const MappedArchive *archive;
+    SensorColumns *buffers;     // one ARCHIVE_BLOCK decode buffer per worker
+    const RollingStats *rolling;    // shared rolling statistics, or NULL
+    int failed;
+} ArchiveScanJob;
+
+// Pool task to decode blocks [begin, end) into the worker's buffer and
+// aggregate them, and feed the worker's sketch and rolling buckets, while
+// they are still in cache
+void archive_chunk(void *ctx, int worker_id, long long begin, long long end) {
+    ArchiveScanJob *job = (ArchiveScanJob *)ctx;
+    ThreadData *data = &thread_data[worker_id];
+    SensorColumns *buffer = &job->buffers[worker_id];
+    const char *base = (const char *)job->archive->mapping;
+    const uint64_t *directory = job->archive->directory;
+    double start_time = now_seconds();
+
+    for (long long b = begin; b < end; b++) {
+        if (decode_block((const uint8_t *)base + directory[b], directory[b + 1] - directory[b], buffer) != 0) {
+            __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        group_kernel(buffer->values, buffer->types, buffer->sectors, buffer->count, &data->totals);
+        if (data->sketch != NULL) {
+            sketch_add_range(data->sketch, buffer, 0, buffer->count);
+        }
+        if (data->rolling != NULL) {
+            rolling_add_range(data->rolling, buffer, 0, buffer->count,
+                              job->rolling->newest_bucket - ROLLING_BUCKETS + 1);
+        }
+        data->readings_processed += buffer->count;
+        data->chunks_processed++;
+    }
+    data->processing_time += now_seconds() - start_time;
+}
+
+// Function to aggregate a compressed archive, decoding blocks on the fly.
+// With 'sketch' or 'rolling' set, the decoded blocks feed them as well.
+int process_archive(ThreadPool *pool, int num_threads, long long chunk_size, const char *path, int verify,
+                    DistributionSketch *sketch, RollingStats *rolling) {
+    MappedArchive archive;
+    if (map_archive(path, &archive, verify) != 0) {
+        return 1;
+    }
+    if (!(archive.header->flags & ARCHIVE_HAS_TIMESTAMPS)) {
+        rolling = NULL;
+    }
+    long long count = archive.header->count;
+    long long num_blocks = archive.header->num_blocks;
+    printf("Sensor archive '%s': %lld readings in %lld blocks, %.2f bytes per reading (%.1fx compression)\n",
+           path, count, num_blocks, (double)archive.mapping_size / (count > 0 ? count : 1),
+           8.0 * count / archive.mapping_size);
+
+    ArchiveScanJob job = {&archive, calloc(num_threads, sizeof(SensorColumns)), rolling, 0};
+    int status = job.buffers == NULL;
+    for (int w = 0; w < num_threads && status == 0; w++) {
+        // Only the aggregated columns are decoded; timestamps only feed rolling statistics
+        status = allocate_columns(&job.buffers[w], ARCHIVE_BLOCK);
+        if (rolling == NULL && job.buffers[w].mapping == NULL) {
+            free(job.buffers[w].timestamps);
+        }
+        if (rolling == NULL) {
+            job.buffers[w].timestamps = NULL;
+        }
+    }
+    if (status != 0) {
+        printf("Memory allocation failed\n");
+    } else {
+        printf("\nStarting multithreaded processing with %d threads (%s kernels, decoding on the fly)...\n",
+               num_threads, kernel_name);
+        double start_time = now_seconds();
+        
+        prepare_worker_sinks(pool, num_threads, &sketch, &rolling);
+        job.rolling = rolling;
+        reset_worker_results(pool, NULL);
+        long long blocks_per_chunk = chunk_size / ARCHIVE_BLOCK > 0 ? chunk_size / ARCHIVE_BLOCK : 1;
+        pool_run(pool, num_threads, num_blocks, blocks_per_chunk, archive_chunk, finish_aggregation, &job);
+        merge_worker_sinks(num_threads, sketch, rolling);
+        
+        double seconds = now_seconds() - start_time;
+        if (job.failed) {
+            printf("Error: '%s' holds a corrupt block\n", path);
+            status = 1;
+        } else {
+            print_worker_report(pool, num_threads);
+            print_aggregation_results(count, num_threads, total_sum, seconds);
+            printf("Compressed bytes read: %.1f MB (%.2f GB/s of archive)\n",
+                   archive.mapping_size / (1024.0 * 1024.0), archive.mapping_size / seconds / 1e9);
+            analyze_sensor_data_by_type(&total_groups);
+            analyze_sensor_data_by_sector(&total_groups);
+            if (sketch != NULL) {
+                print_percentile_report(sketch);
+            }
+        }
+    }
+
+    for (int w = 0; job.buffers != NULL && w < num_threads; w++) {
+        free_columns(&job.buffers[w]);
+    }
+    free(job.buffers);
+    munmap(archive.mapping, archive.mapping_size);
+    return status;
+}
+
+/*
+ * Sharded aggregation
+ *
+ * --coordinator splits a dataset file into shards (contiguous ranges of
+ * readings) and deals them to worker processes, which connect back with
+ * --shard-worker. Each worker maps the file, aggregates its shard with its
+ * own pool and returns only the partial aggregate: the sum plus per-type
+ * and per-sector counts and sums. The coordinator merges these.
+ *
+ * Messages are length-prefixed frames of fixed-layout little-endian structs
+ * (below) over a stream socket, and shards name the dataset by path. A
+ * worker on another node therefore only needs another transport than
+ * unix:PATH and the file at the same path. A worker that disconnects or
+ * dies with a shard outstanding, or holds it past the shard timeout, has
+ * that shard dealt to another worker. A shard that fails SHARD_MAX_ATTEMPTS
+ * times fails the run. Only processes of the coordinator's own user may
+ * connect, and the default socket lives in a private (0700) directory.
+ *
+ *   frame:  magic "AGSH" (u32), version (u16), type (u16), payload bytes (u32), reserved (u32)
+ *   HELLO   worker -> coordinator: pid (u32), threads (u32)
+ *   ASSIGN  coordinator -> worker: shard (u32), path bytes (u32), first reading (u64),
+ *           readings (u64), then the dataset path
+ *   RESULT  worker -> coordinator: shard (u32), status (u32), readings (u64), sum (i64),
+ *           type counts and sums, sector counts and sums (i64 each)
+ *   DONE    coordinator -> worker: no payload; the worker exits
+ */
+#define SHARD_MAGIC 0x48534741u         // "AGSH" read as a little-endian u32
+#define SHARD_VERSION 1
+#define SHARD_HELLO 1
+#define SHARD_ASSIGN 2
+#define SHARD_RESULT 3
+#define SHARD_DONE 4
+#define SHARD_MAX_ATTEMPTS 3
+#define MAX_SHARD_WORKERS 64
+#define SHARD_POLL_MS 200
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;
+    uint32_t length;
+    uint32_t reserved;
+} ShardFrame;
+
+typedef struct {
+    uint32_t pid;
+    uint32_t threads;
+} ShardHello;
+
 typedef struct {
-    int value;
-    SensorType type;
-    int field_sector;
-} SensorReading;
+    uint32_t shard;
+    uint32_t path_length;
+    uint64_t first;
+    uint64_t count;
+} ShardAssign;
 
-// Structure to pass data to threads
 typedef struct {
-    int thread_id;
-    SensorReading *readings;
-    int start_index;
-    int end_index;
-    long long partial_sum;
-    double processing_time;
-} ThreadData;
+    uint32_t shard;
+    uint32_t status;            // 0 on success
+    uint64_t readings;
+    GroupTotals totals;         // starts with the sum of all values
+} ShardResult;
 
-// Global variables
-SensorReading *sensor_readings;
-int n;
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-long long total_sum = 0;
+_Static_assert(sizeof(ShardFrame) == 16, "shard frame layout");
+_Static_assert(sizeof(ShardAssign) == 24, "shard assign layout");
+_Static_assert(sizeof(ShardResult) == 24 + 2 * 8 * (NUM_SENSOR_TYPES + NUM_SECTORS), "shard result layout");
 
-// Function to generate random sensor data
-void generate_sensor_data() {
-    printf("Generating simulated agricultural sensor data...\n");
-    
-    srand(time(NULL));
-    for (int i = 0; i < n; i++) {
-        // Randomly assign sensor type
-        sensor_readings[i].type = rand() % 5;
-        
-        // Generate value based on sensor type
-        switch (sensor_readings[i].type) {
-            case SOIL_MOISTURE:
-                // Soil moisture (0-100%)
-                sensor_readings[i].value = rand() % 101;
-                break;
-            case TEMPERATURE:
-                // Temperature (0-50°C)
-                sensor_readings[i].value = rand() % 51;
-                break;
-            case HUMIDITY:
-                // Humidity (0-100%)
-                sensor_readings[i].value = rand() % 101;
-                break;
-            case LIGHT_INTENSITY:
-                // Light intensity (0-1000 lux)
-                sensor_readings[i].value = rand() % 1001;
-                break;
-            case NUTRIENT_LEVEL:
-                // Nutrient level (0-100 ppm)
-                sensor_readings[i].value = rand() % 101;
-                break;
+// A connected worker, as the coordinator sees it
+typedef struct {
+    int fd;                     // -1 once the worker has gone
+    pid_t pid;                  // from HELLO; 0 until then
+    long long shard;            // shard being aggregated, -1 when idle
+    double deadline;            // when the shard is taken back if no result came
+    long long shards_done;
+    long long readings;
+} ShardPeer;
+
+// The worker processes the coordinator started and has not reaped yet
+typedef struct {
+    pid_t pids[MAX_SHARD_WORKERS];
+    int running;
+} ShardChildren;
+
+// Function to write all of 'length' bytes to a socket
+static int send_fully(int fd, const void *buffer, size_t length) {
+    const char *in = (const char *)buffer;
+    while (length > 0) {
+        ssize_t sent = send(fd, in, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
         }
-        
-        // Assign field sector (1-20)
-        sensor_readings[i].field_sector = (rand() % 20) + 1;
+        if (sent <= 0) {
+            return -1;
+        }
+        in += sent;
+        length -= sent;
     }
+    return 0;
 }
 
-// Function to get sensor type name
-const char* get_sensor_type_name(SensorType type) {
-    switch (type) {
-        case SOIL_MOISTURE: return "Soil Moisture";
-        case TEMPERATURE: return "Temperature";
-        case HUMIDITY: return "Humidity";
-        case LIGHT_INTENSITY: return "Light Intensity";
-        case NUTRIENT_LEVEL: return "Nutrient Level";
-        default: return "Unknown";
+// Function to read exactly 'length' bytes from a socket; -1 on error or EOF
+static int recv_fully(int fd, void *buffer, size_t length) {
+    char *out = (char *)buffer;
+    while (length > 0) {
+        ssize_t got = recv(fd, out, length, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return -1;
+        }
+        out += got;
+        length -= got;
     }
+    return 0;
 }
 
-// Thread function to calculate partial sum
-void *calculate_partial_sum(void *arg) {
-    ThreadData *data = (ThreadData *)arg;
-    data->partial_sum = 0;
-    
-    // Record start time
-    clock_t start_time = clock();
-    
-    // Calculate sum for this thread's portion of the array
-    for (int i = data->start_index; i < data->end_index; i++) {
-        data->partial_sum += sensor_readings[i].value;
+// Function to send one frame whose payload is 'payload' followed by 'extra'
+int shard_send(int fd, uint16_t type, const void *payload, size_t length, const void *extra, size_t extra_length) {
+    char message[sizeof(ShardFrame) + sizeof(ShardResult) + PATH_MAX];
+    ShardFrame frame = {SHARD_MAGIC, SHARD_VERSION, type, (uint32_t)(length + extra_length), 0};
+    if (length + extra_length > sizeof(message) - sizeof(frame)) {
+        return -1;
     }
-    
-    // Record end time and calculate processing time
-    clock_t end_time = clock();
-    data->processing_time = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-    
-    // Print thread results for debugging
-    printf("Thread %d: Processed sensor readings from index %d to %d = %lld (%.4f seconds)\n", 
-           data->thread_id, data->start_index, data->end_index - 1, data->partial_sum, data->processing_time);
-    
-    // Add this thread's sum to the total (using mutex for thread safety)
-    pthread_mutex_lock(&mutex);
-    total_sum += data->partial_sum;
-    pthread_mutex_unlock(&mutex);
-    
-    pthread_exit(NULL);
+    memcpy(message, &frame, sizeof(frame));
+    if (length > 0) {
+        memcpy(message + sizeof(frame), payload, length);
+    }
+    if (extra_length > 0) {
+        memcpy(message + sizeof(frame) + length, extra, extra_length);
+    }
+    return send_fully(fd, message, sizeof(frame) + length + extra_length);
 }
 
-// Function to analyze sensor data by type
-void analyze_sensor_data_by_type() {
-    int type_counts[5] = {0};
-    long long type_sums[5] = {0};
-    
-    for (int i = 0; i < n; i++) {
-        SensorType type = sensor_readings[i].type;
-        type_counts[type]++;
-        type_sums[type] += sensor_readings[i].value;
+// Function to receive one frame header and check that it is a known
+// message with the payload size 'type' implies (at most 'max_length')
+int shard_receive(int fd, ShardFrame *frame, size_t max_length) {
+    if (recv_fully(fd, frame, sizeof(*frame)) != 0) {
+        return -1;
     }
-    
-    printf("\n===== Sensor Data Analysis by Type =====\n");
-    for (int i = 0; i < 5; i++) {
-        if (type_counts[i] > 0) {
-            double average = (double)type_sums[i] / type_counts[i];
-            printf("%s: %d readings, Sum: %lld, Average: %.2f\n", 
-                   get_sensor_type_name((SensorType)i), type_counts[i], type_sums[i], average);
+    if (frame->magic != SHARD_MAGIC || frame->version != SHARD_VERSION || frame->length > max_length) {
+        printf("Error: malformed shard protocol frame\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to connect to a coordinator at 'address' (unix:PATH or PATH)
+int shard_connect(const char *address) {
+    struct sockaddr_un sockaddr;
+    const char *path = strncmp(address, "unix:", 5) == 0 ? address + 5 : address;
+    if (strlen(path) >= sizeof(sockaddr.sun_path)) {
+        printf("Error: socket path '%s' is too long\n", path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Failed to create socket");
+        return -1;
+    }
+    memset(&sockaddr, 0, sizeof(sockaddr));
+    sockaddr.sun_family = AF_UNIX;
+    strcpy(sockaddr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&sockaddr, sizeof(sockaddr)) != 0) {
+        perror("Failed to connect to coordinator");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Function to run a shard worker: aggregate every shard the coordinator at
+// 'address' assigns until it says DONE
+int run_shard_worker(const char *address, int num_threads, long long chunk_size) {
+    int fd = shard_connect(address);
+    if (fd < 0) {
+        return 1;
+    }
+    ThreadPool *pool = pool_create(num_threads);
+    if (pool == NULL) {
+        printf("Failed to create thread pool\n");
+        close(fd);
+        return 1;
+    }
+
+    SensorColumns dataset;
+    char dataset_path[PATH_MAX] = "";
+    memset(&dataset, 0, sizeof(dataset));
+    ShardHello hello = {(uint32_t)getpid(), (uint32_t)num_threads};
+    int status = shard_send(fd, SHARD_HELLO, &hello, sizeof(hello), NULL, 0);
+
+    ShardFrame frame;
+    while (status == 0 && shard_receive(fd, &frame, sizeof(ShardAssign) + PATH_MAX - 1) == 0) {
+        if (frame.type == SHARD_DONE) {
+            break;
+        }
+        ShardAssign assign;
+        char path[PATH_MAX];
+        if (frame.type != SHARD_ASSIGN || frame.length < sizeof(assign) ||
+            recv_fully(fd, &assign, sizeof(assign)) != 0 ||
+            assign.path_length != frame.length - sizeof(assign) ||
+            recv_fully(fd, path, assign.path_length) != 0) {
+            status = 1;
+            break;
+        }
+        path[assign.path_length] = '\0';
+
+        // Shards of the same dataset share one mapping
+        ShardResult result;
+        memset(&result, 0, sizeof(result));
+        result.shard = assign.shard;
+        if (strcmp(path, dataset_path) != 0) {
+            free_columns(&dataset);
+            dataset_path[0] = '\0';
+            if (map_dataset(path, &dataset, 0) == 0) {
+                strcpy(dataset_path, path);
+            }
         }
+        if (dataset_path[0] == '\0' || assign.first > (uint64_t)dataset.count ||
+            assign.count > (uint64_t)dataset.count - assign.first) {
+            result.status = 1;
+        } else {
+            SensorColumns shard = dataset;
+            shard.values += assign.first;
+            shard.types += assign.first;
+            shard.sectors += assign.first;
+            shard.timestamps = NULL;
+            shard.count = (long long)assign.count;
+            shard.mapping = NULL;
+            prefetch_readings(&shard, 0, shard.count);
+            run_parallel_aggregation(pool, num_threads, &shard, chunk_size, NULL, NULL);
+            result.readings = assign.count;
+            result.totals = total_groups;
+        }
+        status = shard_send(fd, SHARD_RESULT, &result, sizeof(result), NULL, 0);
     }
+
+    free_columns(&dataset);
+    pool_destroy(pool);
+    close(fd);
+    return status != 0;
 }
 
-// Function to analyze sensor data by field sector
-void analyze_sensor_data_by_sector() {
-    // We have 20 sectors
-    int sector_counts[20] = {0};
-    long long sector_sums[20] = {0};
-    
-    for (int i = 0; i < n; i++) {
-        int sector = sensor_readings[i].field_sector - 1; // Convert to 0-based index
-        sector_counts[sector]++;
-        sector_sums[sector] += sensor_readings[i].value;
+// Function to start a worker process that connects back to 'address'
+pid_t spawn_shard_worker(const char *program, const char *address, int threads, long long chunk_size,
+                         const char *kernel) {
+    char thread_arg[16], chunk_arg[32];
+    snprintf(thread_arg, sizeof(thread_arg), "%d", threads);
+    snprintf(chunk_arg, sizeof(chunk_arg), "%lld", chunk_size);
+    char *args[] = {(char *)program, "--shard-worker", (char *)address, "-t", thread_arg, "-c", chunk_arg,
+                    kernel != NULL ? "--kernel" : NULL, (char *)kernel, NULL};
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // The same binary, even if argv[0] is not a usable path
+        execv("/proc/self/exe", args);
+        execvp(program, args);
+        _exit(127);
     }
-    
-    printf("\n===== Sensor Data Analysis by Field Sector =====\n");
-    for (int i = 0; i < 20; i++) {
-        if (sector_counts[i] > 0) {
-            double average = (double)sector_sums[i] / sector_counts[i];
-            printf("Sector %d: %d readings, Sum: %lld, Average: %.2f\n", 
-                   i+1, sector_counts[i], sector_sums[i], average);
+    return pid;
+}
+
+// Function to hand shard 'shard' to 'peer'; -1 if the worker is unreachable
+int shard_assign(ShardPeer *peer, const char *path, long long shard, long long count, long long num_shards) {
+    // Shard s covers readings [s * count / num_shards, (s + 1) * count / num_shards)
+    uint64_t first = (uint64_t)((unsigned __int128)shard * count / num_shards);
+    uint64_t end = (uint64_t)((unsigned __int128)(shard + 1) * count / num_shards);
+    ShardAssign assign = {(uint32_t)shard, (uint32_t)strlen(path), first, end - first};
+    if (shard_send(peer->fd, SHARD_ASSIGN, &assign, sizeof(assign), path, assign.path_length) != 0) {
+        return -1;
+    }
+    peer->shard = shard;
+    return 0;
+}
+
+// Function to start a local worker and record it in 'children'; 0 on success
+static int shard_start_worker(ShardChildren *children, const char *program, const char *address, int threads,
+                              long long chunk_size, const char *kernel) {
+    if (children->running >= MAX_SHARD_WORKERS) {
+        return -1;
+    }
+    pid_t pid = spawn_shard_worker(program, address, threads, chunk_size, kernel);
+    if (pid <= 0) {
+        return -1;
+    }
+    children->pids[children->running++] = pid;
+    return 0;
+}
+
+// Function to reap the children that have exited ('options' WNOHANG) or,
+// with 'options' 0, to wait for all of them. Only recorded pids are
+// waited for, and each is forgotten as soon as it is reaped.
+static void shard_reap_children(ShardChildren *children, int options) {
+    for (int c = children->running - 1; c >= 0; c--) {
+        pid_t reaped;
+        while ((reaped = waitpid(children->pids[c], NULL, options)) < 0 && errno == EINTR) {
+        }
+        if (reaped != 0) {
+            children->pids[c] = children->pids[--children->running];
         }
     }
 }
 
-int main() {
-    // Get the value of n from the user
-    printf("===== Agricultural Sensor Data Processing System =====\n");
-    printf("This system demonstrates multithreaded processing of large sensor datasets\n");
-    printf("for agricultural technology applications.\n\n");
-    
-    printf("Enter the number of sensor readings to process (n > %d): ", MIN_ARRAY_SIZE);
-    scanf("%d", &n);
-    
-    // Validate input
-    if (n <= MIN_ARRAY_SIZE) {
-        printf("Error: n must be greater than %d\n", MIN_ARRAY_SIZE);
+// Function to kill and reap worker 'pid' if it is an unreaped child of
+// this process. Returns 1 if it was, so that it can be replaced.
+static int shard_stop_child(ShardChildren *children, pid_t pid) {
+    for (int c = 0; c < children->running; c++) {
+        if (pid > 0 && children->pids[c] == pid) {
+            kill(pid, SIGKILL);
+            while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {
+            }
+            children->pids[c] = children->pids[--children->running];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Function to give up on the shard 'peer' holds: its connection is closed
+// and the shard put back. Returns 1 once the shard has failed
+// SHARD_MAX_ATTEMPTS times.
+static int shard_take_back(ShardPeer *peer, long long *pending, long long *num_pending, int *attempts) {
+    close(peer->fd);
+    peer->fd = -1;
+    if (peer->shard < 0) {
+        return 0;
+    }
+    long long shard = peer->shard;
+    peer->shard = -1;
+    pending[(*num_pending)++] = shard;
+    return ++attempts[shard] >= SHARD_MAX_ATTEMPTS;
+}
+
+// Function to coordinate a sharded aggregation of the dataset at 'path'
+// over 'num_workers' local worker processes (0: wait for external ones).
+// A worker gets 'shard_timeout' seconds per shard before it is replaced.
+int run_coordinator(const char *program, const char *path, int num_workers, long long num_shards,
+                    const char *socket_path, int num_threads, long long chunk_size, const char *kernel,
+                    int verify, double shard_timeout) {
+    // Only the header is read here (and, with 'verify', the checksum
+    // checked once for all shards); the workers map the readings
+    DatasetHeader header;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0 || read_fully(fd, &header, sizeof(header), 0) != 0 ||
+        validate_dataset_header(&header, st.st_size) != 0) {
+        printf("Error: '%s' is not a readable sensor dataset\n", path);
+        if (fd >= 0) {
+            close(fd);
+        }
         return 1;
     }
-    
-    // Allocate memory for the sensor readings array
-    sensor_readings = (SensorReading *)malloc(n * sizeof(SensorReading));
-    if (sensor_readings == NULL) {
-        printf("Memory allocation failed\n");
+    if (verify && verify_dataset_file(fd, &header, path) != 0) {
+        close(fd);
         return 1;
     }
+    close(fd);
+    char full_path[PATH_MAX];
+    if (realpath(path, full_path) == NULL) {
+        perror("Failed to resolve dataset path");
+        return 1;
+    }
+    long long count = header.count;
+    if (num_shards == 0) {
+        num_shards = 4LL * (num_workers > 0 ? num_workers : 4);
+    }
+    if (num_shards > count) {
+        num_shards = count > 0 ? count : 1;
+    }
+
+    // The default socket goes in a fresh directory only this user can enter
+    char socket_dir[] = "/tmp/agsensor-XXXXXX";
+    char default_socket[64];
+    if (socket_path == NULL) {
+        if (mkdtemp(socket_dir) == NULL) {
+            perror("Failed to create socket directory");
+            return 1;
+        }
+        snprintf(default_socket, sizeof(default_socket), "%s/coordinator.sock", socket_dir);
+        socket_path = default_socket;
+    } else {
+        socket_dir[0] = '\0';
+    }
+    char address[sizeof(((struct sockaddr_un *)0)->sun_path) + 8];
+    snprintf(address, sizeof(address), "unix:%s", socket_path);
+    int listen_fd = live_listen_unix(socket_path);
+    long long *pending = (long long *)malloc(num_shards * sizeof(long long));
+    int *attempts = (int *)calloc(num_shards, sizeof(int));
+    int peer_capacity = MAX_SHARD_WORKERS;
+    ShardPeer *peers = (ShardPeer *)calloc(peer_capacity, sizeof(ShardPeer));
+    if (listen_fd < 0 || pending == NULL || attempts == NULL || peers == NULL) {
+        if (listen_fd >= 0) {
+            close(listen_fd);
+            unlink(socket_path);
+        } else {
+            printf("Error: cannot listen on '%s'\n", socket_path);
+        }
+        if (socket_dir[0] != '\0') {
+            rmdir(socket_dir);
+        }
+        free(pending);
+        free(attempts);
+        free(peers);
+        return 1;
+    }
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+
+    // Pending shards form a stack, filled so that shard 0 is dealt first
+    long long num_pending = 0;
+    for (long long s = num_shards - 1; s >= 0; s--) {
+        pending[num_pending++] = s;
+    }
+    int worker_threads = num_workers > 0 && num_threads / num_workers > 1 ? num_threads / num_workers : 1;
+    printf("Coordinating '%s': %lld readings in %lld shards over %d worker processes "
+           "(%d threads each) on %s\n", path, count, num_shards, num_workers, worker_threads, address);
+    if (num_workers == 0) {
+        printf("Waiting for workers: start them with --shard-worker %s\n", address);
+    }
+
+    ShardChildren children;
+    children.running = 0;
+    for (int w = 0; w < num_workers; w++) {
+        shard_start_worker(&children, program, address, worker_threads, chunk_size, kernel);
+    }
+
+    double start_time = now_seconds();
+    long long shards_done = 0, readings = 0, reassigned = 0, timed_out = 0;
+    GroupTotals totals;
+    memset(&totals, 0, sizeof(totals));
+    int num_peers = 0, peers_alive = 0, status = 0;
+
+    while (shards_done < num_shards && status == 0) {
+        // Reap exited children; a worker that dies before connecting only
+        // shows up here, one that dies after also closes its socket
+        shard_reap_children(&children, WNOHANG);
+        if (num_workers > 0 && children.running == 0 && peers_alive == 0) {
+            printf("Error: every worker process exited with %lld of %lld shards left\n",
+                   num_shards - shards_done, num_shards);
+            status = 1;
+            break;
+        }
+
+        struct pollfd fds[MAX_SHARD_WORKERS + 1];
+        int slots[MAX_SHARD_WORKERS + 1];
+        int num_fds = 0;
+        fds[num_fds].fd = listen_fd;
+        fds[num_fds++].events = POLLIN;
+        for (int p = 0; p < num_peers; p++) {
+            if (peers[p].fd >= 0) {
+                slots[num_fds] = p;
+                fds[num_fds].fd = peers[p].fd;
+                fds[num_fds++].events = POLLIN;
+            }
+        }
+        if (poll(fds, num_fds, SHARD_POLL_MS) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("poll failed");
+            status = 1;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            // Results are only taken from processes of the same user
+            int peer_fd = accept(listen_fd, NULL, NULL);
+            if (peer_fd >= 0 && peer_is_same_user(peer_fd) != 0) {
+                printf("Rejected a worker connection from another user\n");
+                close(peer_fd);
+                peer_fd = -1;
+            }
+            if (peer_fd >= 0 && peers_alive < MAX_SHARD_WORKERS && num_peers == peer_capacity) {
+                // Workers that have gone keep their row for the per-worker table
+                ShardPeer *grown = (ShardPeer *)realloc(peers, 2 * peer_capacity * sizeof(ShardPeer));
+                if (grown != NULL) {
+                    peers = grown;
+                    peer_capacity *= 2;
+                }
+            }
+            if (peer_fd >= 0 && peers_alive < MAX_SHARD_WORKERS && num_peers < peer_capacity) {
+                memset(&peers[num_peers], 0, sizeof(ShardPeer));
+                peers[num_peers].fd = peer_fd;
+                peers[num_peers].shard = -1;
+                num_peers++;
+                peers_alive++;
+            } else if (peer_fd >= 0) {
+                close(peer_fd);
+            }
+        }
+
+        for (int k = 1; k < num_fds && status == 0; k++) {
+            if (fds[k].revents == 0) {
+                continue;
+            }
+            ShardPeer *peer = &peers[slots[k]];
+            ShardFrame frame;
+            ShardHello hello;
+            ShardResult result;
+            int lost = shard_receive(peer->fd, &frame, sizeof(ShardResult)) != 0;
+            if (!lost && frame.type == SHARD_HELLO && frame.length == sizeof(hello) &&
+                recv_fully(peer->fd, &hello, sizeof(hello)) == 0) {
+                peer->pid = (pid_t)hello.pid;
+            } else if (!lost && frame.type == SHARD_RESULT && frame.length == sizeof(result) &&
+                       recv_fully(peer->fd, &result, sizeof(result)) == 0 && result.shard == peer->shard) {
+                long long shard = peer->shard;
+                uint64_t expected = (uint64_t)((unsigned __int128)(shard + 1) * count / num_shards) -
+                                    (uint64_t)((unsigned __int128)shard * count / num_shards);
+                peer->shard = -1;
+                if (result.status == 0 && result.readings == expected) {
+                    shards_done++;
+                    readings += result.readings;
+                    merge_group_totals(&totals, &result.totals);
+                    peer->shards_done++;
+                    peer->readings += result.readings;
+                } else {
+                    printf("Worker %d could not aggregate shard %lld\n", (int)peer->pid, shard);
+                    pending[num_pending++] = shard;
+                    status = ++attempts[shard] >= SHARD_MAX_ATTEMPTS;
+                }
+            } else {
+                lost = 1;
+            }
+
+            if (lost) {
+                // Gone, or speaking something else: its shard goes to another
+                // worker, and a worker this process started is replaced
+                if (peer->shard >= 0) {
+                    printf("Lost worker %d with shard %lld; reassigning it\n", (int)peer->pid, peer->shard);
+                    reassigned++;
+                }
+                peers_alive--;
+                int ours = shard_stop_child(&children, peer->pid);
+                status = shard_take_back(peer, pending, &num_pending, attempts);
+                if (ours && status == 0) {
+                    shard_start_worker(&children, program, address, worker_threads, chunk_size, kernel);
+                }
+            }
+        }
+
+        // A worker still connected but silent past its deadline is replaced
+        double now = now_seconds();
+        for (int p = 0; p < num_peers && status == 0; p++) {
+            if (peers[p].fd < 0 || peers[p].shard < 0 || now < peers[p].deadline) {
+                continue;
+            }
+            printf("Worker %d missed the %.0f s deadline for shard %lld; reassigning it\n",
+                   (int)peers[p].pid, shard_timeout, peers[p].shard);
+            reassigned++;
+            timed_out++;
+            peers_alive--;
+            int ours = shard_stop_child(&children, peers[p].pid);
+            status = shard_take_back(&peers[p], pending, &num_pending, attempts);
+            if (ours && status == 0) {
+                shard_start_worker(&children, program, address, worker_threads, chunk_size, kernel);
+            }
+        }
+        if (status != 0) {
+            printf("Error: a shard failed %d times; giving up\n", SHARD_MAX_ATTEMPTS);
+            break;
+        }
+
+        // Deal pending shards to idle workers that have said hello
+        for (int p = 0; p < num_peers && num_pending > 0; p++) {
+            if (peers[p].fd >= 0 && peers[p].pid != 0 && peers[p].shard < 0) {
+                long long shard = pending[--num_pending];
+                if (shard_assign(&peers[p], full_path, shard, count, num_shards) != 0) {
+                    pending[num_pending++] = shard;
+                    close(peers[p].fd);
+                    peers[p].fd = -1;
+                    peers_alive--;
+                } else {
+                    peers[p].deadline = now_seconds() + shard_timeout;
+                }
+            }
+        }
+    }
+    double seconds = now_seconds() - start_time;
+
+    // Release the workers and wait for the ones this process started
+    for (int p = 0; p < num_peers; p++) {
+        if (peers[p].fd >= 0) {
+            shard_send(peers[p].fd, SHARD_DONE, NULL, 0, NULL, 0);
+            close(peers[p].fd);
+        }
+    }
+    shard_reap_children(&children, 0);
+    close(listen_fd);
+    unlink(socket_path);
+    if (socket_dir[0] != '\0') {
+        rmdir(socket_dir);
+    }
+
+    if (status == 0) {
+        total_sum = totals.sum;
+        total_groups = totals;
+        print_aggregation_results(readings, num_threads, totals.sum, seconds);
+        printf("Shards: %lld, reassigned after worker failures: %lld (%lld past the deadline)\n",
+               num_shards, reassigned, timed_out);
+        printf("%-10s %-8s %-14s\n", "Worker", "Shards", "Readings");
+        for (int p = 0; p < num_peers; p++) {
+            // A replacement may connect just as the last shard comes in, before its HELLO
+            if (peers[p].pid != 0) {
+                printf("%-10d %-8lld %-14lld\n", (int)peers[p].pid, peers[p].shards_done, peers[p].readings);
+            }
+        }
+        analyze_sensor_data_by_type(&totals);
+        analyze_sensor_data_by_sector(&totals);
+    }
+    free(pending);
+    free(attempts);
+    free(peers);
+    return status;
+}
+
+int main(int argc, char *argv[]) {
+    int num_threads = detect_thread_count();
+    long long chunk_size = DEFAULT_CHUNK_SIZE;
+    long long batch_size = 0;           // 0 = the default of the chosen mode
+    int batch_given = 0;
+    int show_scaling = 0;
+    long long self_check_count = 0;
+    const char *kernel_request = NULL;
+    const char *input_path = NULL;
+    const char *stream_path = NULL;
+    const char *output_path = NULL;
+    const char *archive_path = NULL;
+    const char *archive_output = NULL;
+    const char *ingest_source = NULL;
+    int io_depth = DEFAULT_INGEST_DEPTH;
+    const char *io_backend = "uring";
+    int verify_checksum = 0;
+    uint64_t seed = (uint64_t)time(NULL);
+    long long span = DEFAULT_SPAN_SECONDS;
+    long long rolling_window = DEFAULT_ROLLING_WINDOW;
+    const char *query = NULL;
+    int query_sector = 0;
+    int query_type = -1;
+    const char *sketch_request = NULL;
+    const char *where = NULL;
+    const char *group_by = NULL;
+    SensorQuery sensor_query;
+    DistributionSketch *sketch = NULL;
+    int bench_mode = 0;
+    int pin_threads = 0;
+    int numa_mode = 0;
+    int perf_mode = 0;
+    const char *huge_pages = NULL;
+    const char *live_source = NULL;
+    int num_aggregators = 2;
+    long long publish_ms = DEFAULT_PUBLISH_MS;
+    long long report_ms = DEFAULT_REPORT_MS;
+    long long emit_count = 0;
+    const char *coordinator_path = NULL;
+    const char *shard_worker = NULL;
+    const char *socket_path = NULL;
+    int num_workers = 2;
+    long long num_shards = 0;
+    double shard_timeout = DEFAULT_SHARD_TIMEOUT;
+    const char *bench_threads = NULL;
+    const char *bench_sizes = NULL;
+    BenchConfig bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.warmup = DEFAULT_BENCH_WARMUP;
+    bench.trials = DEFAULT_BENCH_TRIALS;
+    bench.format = "text";
+    n = 0;
     
-    // Generate simulated sensor data
-    generate_sensor_data();
-    
-    // Create threads and thread data
-    pthread_t threads[NUM_THREADS];
-    ThreadData thread_data[NUM_THREADS];
-    
-    // Calculate elements per thread
-    int elements_per_thread = n / NUM_THREADS;
-    int remaining_elements = n % NUM_THREADS;
-    
-    printf("\nStarting multithreaded processing with %d threads...\n", NUM_THREADS);
-    
-    // Record start time for multithreaded processing
-    clock_t mt_start_time = clock();
-    
-    // Create and start threads
-    int start_index = 0;
-    for (int i = 0; i < NUM_THREADS; i++) {
-        thread_data[i].thread_id = i;
-        thread_data[i].readings = sensor_readings;
-        thread_data[i].start_index = start_index;
-        
-        // Distribute remaining elements among first 'remaining_elements' threads
-        int extra = (i < remaining_elements) ? 1 : 0;
-        thread_data[i].end_index = start_index + elements_per_thread + extra;
-        
-        start_index = thread_data[i].end_index;
+    // Parse command-line options
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        int has_value = i + 1 < argc;
         
-        printf("Creating thread %d to process readings from index %d to %d\n", 
-               i, thread_data[i].start_index, thread_data[i].end_index - 1);
-        
-        if (pthread_create(&threads[i], NULL, calculate_partial_sum, (void *)&thread_data[i]) != 0) {
-            perror("Failed to create thread");
-            free(sensor_readings);
+        if ((strcmp(arg, "-n") == 0 || strcmp(arg, "--readings") == 0) && has_value) {
+            n = atoll(argv[++i]);
+        } else if ((strcmp(arg, "-t") == 0 || strcmp(arg, "--threads") == 0) && has_value) {
+            num_threads = atoi(argv[++i]);
+        } else if ((strcmp(arg, "-c") == 0 || strcmp(arg, "--chunk") == 0) && has_value) {
+            chunk_size = atoll(argv[++i]);
+        } else if ((strcmp(arg, "-i") == 0 || strcmp(arg, "--input") == 0) && has_value) {
+            input_path = argv[++i];
+        } else if ((strcmp(arg, "-s") == 0 || strcmp(arg, "--stream") == 0) && has_value) {
+            stream_path = argv[++i];
+        } else if (strcmp(arg, "--batch") == 0 && has_value) {
+            batch_size = atoll(argv[++i]);
+            batch_given = 1;
+        } else if (strcmp(arg, "--ingest") == 0 && has_value) {
+            ingest_source = argv[++i];
+        } else if (strcmp(arg, "--io-depth") == 0 && has_value) {
+            io_depth = atoi(argv[++i]);
+        } else if (strcmp(arg, "--io") == 0 && has_value) {
+            io_backend = argv[++i];
+        } else if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--write") == 0) && has_value) {
+            output_path = argv[++i];
+        } else if ((strcmp(arg, "-a") == 0 || strcmp(arg, "--archive") == 0) && has_value) {
+            archive_path = argv[++i];
+        } else if (strcmp(arg, "--write-archive") == 0 && has_value) {
+            archive_output = argv[++i];
+        } else if (strcmp(arg, "--verify-checksum") == 0) {
+            verify_checksum = 1;
+        } else if (strcmp(arg, "--seed") == 0 && has_value) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(arg, "--span") == 0 && has_value) {
+            span = atoll(argv[++i]);
+        } else if (strcmp(arg, "--window") == 0 && has_value) {
+            rolling_window = atoll(argv[++i]);
+        } else if (strcmp(arg, "--query") == 0 && has_value) {
+            query = argv[++i];
+        } else if (strcmp(arg, "--sketch") == 0 && has_value) {
+            sketch_request = argv[++i];
+        } else if (strcmp(arg, "--where") == 0 && has_value) {
+            where = argv[++i];
+        } else if (strcmp(arg, "--group-by") == 0 && has_value) {
+            group_by = argv[++i];
+        } else if (strcmp(arg, "--kernel") == 0 && has_value) {
+            kernel_request = argv[++i];
+        } else if (strcmp(arg, "--live") == 0 && has_value) {
+            live_source = argv[++i];
+        } else if (strcmp(arg, "--aggregators") == 0 && has_value) {
+            num_aggregators = atoi(argv[++i]);
+        } else if (strcmp(arg, "--publish-ms") == 0 && has_value) {
+            publish_ms = atoll(argv[++i]);
+        } else if (strcmp(arg, "--report-ms") == 0 && has_value) {
+            report_ms = atoll(argv[++i]);
+        } else if (strcmp(arg, "--emit") == 0 && has_value) {
+            emit_count = atoll(argv[++i]);
+        } else if (strcmp(arg, "--coordinator") == 0 && has_value) {
+            coordinator_path = argv[++i];
+        } else if (strcmp(arg, "--workers") == 0 && has_value) {
+            num_workers = atoi(argv[++i]);
+        } else if (strcmp(arg, "--shards") == 0 && has_value) {
+            num_shards = atoll(argv[++i]);
+        } else if (strcmp(arg, "--socket") == 0 && has_value) {
+            socket_path = argv[++i];
+        } else if (strcmp(arg, "--shard-timeout") == 0 && has_value) {
+            shard_timeout = atof(argv[++i]);
+        } else if (strcmp(arg, "--shard-worker") == 0 && has_value) {
+            shard_worker = argv[++i];
+        } else if (strcmp(arg, "--perf") == 0) {
+            perf_mode = 1;
+        } else if (strcmp(arg, "--huge-pages") == 0 && has_value) {
+            huge_pages = argv[++i];
+        } else if (strcmp(arg, "--pin") == 0) {
+            pin_threads = 1;
+        } else if (strcmp(arg, "--numa") == 0) {
+            numa_mode = 1;
+            pin_threads = 1;
+        } else if (strcmp(arg, "--bench") == 0) {
+            bench_mode = 1;
+        } else if (strcmp(arg, "--warmup") == 0 && has_value) {
+            bench.warmup = atoi(argv[++i]);
+        } else if (strcmp(arg, "--trials") == 0 && has_value) {
+            bench.trials = atoi(argv[++i]);
+        } else if (strcmp(arg, "--bench-threads") == 0 && has_value) {
+            bench_threads = argv[++i];
+        } else if (strcmp(arg, "--bench-sizes") == 0 && has_value) {
+            bench_sizes = argv[++i];
+        } else if (strcmp(arg, "--format") == 0 && has_value) {
+            bench.format = argv[++i];
+        } else if (strcmp(arg, "--bench-out") == 0 && has_value) {
+            bench.output = argv[++i];
+        } else if (strcmp(arg, "--scaling") == 0) {
+            show_scaling = 1;
+        } else if (strcmp(arg, "--self-check") == 0 && has_value) {
+            self_check_count = atoll(argv[++i]);
+        } else if (strcmp(arg, "-h") == 0 || strcmp(arg, "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            printf("Error: unknown or incomplete option '%s'\n", arg);
+            print_usage(argv[0]);
             return 1;
         }
     }
     
-    // Wait for all threads to complete
-    for (int i = 0; i < NUM_THREADS; i++) {
-        pthread_join(threads[i], NULL);
+    if (num_threads < 1 || num_threads > MAX_THREADS) {
+        printf("Error: thread count must be between 1 and %d\n", MAX_THREADS);
+        return 1;
+    }
+    if (chunk_size < 1 || (batch_given && batch_size < 1)) {
+        printf("Error: chunk and batch sizes must be positive\n");
+        return 1;
+    }
+    if (io_depth < 1 || io_depth > MAX_INGEST_DEPTH ||
+        (strcmp(io_backend, "uring") != 0 && strcmp(io_backend, "pread") != 0)) {
+        printf("Error: --io must be uring or pread and --io-depth between 1 and %d\n", MAX_INGEST_DEPTH);
+        return 1;
+    }
+    if (span < 1 || span > UINT32_MAX - GENERATED_EPOCH || rolling_window < 1) {
+        printf("Error: --span and --window must be positive\n");
+        return 1;
+    }
+    if (query != NULL) {
+        const char *colon = strchr(query, ':');
+        query_sector = atoi(query);
+        query_type = colon != NULL ? parse_sensor_type(colon + 1) : -1;
+        if (query_sector < 1 || query_sector > NUM_SECTORS || query_type < 0) {
+            printf("Error: --query expects SECTOR:TYPE, e.g. 7:soil (sectors 1-%d)\n", NUM_SECTORS);
+            return 1;
+        }
+    }
+    if (sketch_request != NULL && strcmp(sketch_request, "hist") != 0 && strcmp(sketch_request, "kll") != 0) {
+        printf("Error: --sketch must be hist or kll\n");
+        return 1;
+    }
+    if (group_by != NULL && where == NULL) {
+        where = "value>=0";
+    }
+    if (where != NULL) {
+        if (parse_query(where, group_by, &sensor_query) != 0) {
+            return 1;
+        }
+        if (stream_path != NULL || ingest_source != NULL || bench_mode) {
+            printf("Error: --where runs on an in-memory or mapped dataset, not with --stream, --ingest or --bench\n");
+            return 1;
+        }
+    }
+    if ((input_path != NULL) + (stream_path != NULL) + (archive_path != NULL) + (ingest_source != NULL) > 1) {
+        printf("Error: --input, --stream, --ingest and --archive cannot be combined\n");
+        return 1;
+    }
+    if (archive_path != NULL && (bench_mode || where != NULL)) {
+        printf("Error: --archive cannot be combined with --bench or --where\n");
+        return 1;
+    }
+    if (bench_mode && (stream_path != NULL || ingest_source != NULL)) {
+        printf("Error: --bench runs on an in-memory or mapped dataset, not --stream or --ingest\n");
+        return 1;
+    }
+    if (self_check_count > 0 && (input_path != NULL || stream_path != NULL || ingest_source != NULL ||
+                                 archive_path != NULL || bench_mode || where != NULL || perf_mode)) {
+        printf("Error: --self-check aggregates its own synthetic readings and runs alone\n");
+        return 1;
+    }
+    if (verify_checksum && (live_source != NULL || shard_worker != NULL)) {
+        printf("Error: --verify-checksum does not apply to --live or --shard-worker (give it to --coordinator)\n");
+        return 1;
+    }
+    if (perf_mode && (stream_path != NULL || ingest_source != NULL || archive_path != NULL ||
+                      bench_mode || where != NULL || live_source != NULL)) {
+        printf("Error: --perf instruments generated or --input runs only\n");
+        return 1;
+    }
+    if (huge_pages != NULL) {
+        if (strcmp(huge_pages, "thp") == 0) {
+            page_mode = PAGES_THP;
+        } else if (strcmp(huge_pages, "2m") == 0) {
+            page_mode = PAGES_HUGETLB_2MB;
+        } else if (strcmp(huge_pages, "1g") == 0) {
+            page_mode = PAGES_HUGETLB_1GB;
+        } else {
+            printf("Error: --huge-pages must be thp, 2m or 1g\n");
+            return 1;
+        }
+        if (input_path != NULL || archive_path != NULL) {
+            printf("Error: --huge-pages backs generated, streamed or ingested readings, not --input or --archive\n");
+            return 1;
+        }
+        bench.compare_pages = 1;
+    }
+    if (coordinator_path != NULL) {
+        if (num_workers < 0 || num_workers > MAX_SHARD_WORKERS || num_shards < 0 || !(shard_timeout > 0)) {
+            printf("Error: --workers must be 0-%d, and --shards and --shard-timeout positive\n", MAX_SHARD_WORKERS);
+            return 1;
+        }
+        if (input_path != NULL || stream_path != NULL || ingest_source != NULL || archive_path != NULL ||
+            bench_mode || where != NULL || perf_mode || live_source != NULL) {
+            printf("Error: --coordinator aggregates a dataset file on its own; drop the other modes\n");
+            return 1;
+        }
+    }
+    if (select_kernels(kernel_request) != 0) {
+        printf("Error: kernel '%s' is unknown or not supported on this CPU\n", kernel_request);
+        return 1;
+    }
+    if (bench_mode) {
+        if (bench.warmup < 0 || bench.trials < 1) {
+            printf("Error: --warmup must be >= 0 and --trials >= 1\n");
+            return 1;
+        }
+        if (strcmp(bench.format, "text") != 0 && strcmp(bench.format, "csv") != 0 &&
+            strcmp(bench.format, "json") != 0) {
+            printf("Error: --format must be text, csv or json\n");
+            return 1;
+        }
+        if (bench_threads != NULL) {
+            bench.num_threads = parse_count_list(bench_threads, bench.threads, MAX_BENCH_POINTS);
+        } else {
+            for (long long t = 1; t < num_threads; t *= 2) {
+                bench.threads[bench.num_threads++] = t;
+            }
+            bench.threads[bench.num_threads++] = num_threads;
+        }
+        if (bench_sizes != NULL) {
+            bench.num_sizes = parse_count_list(bench_sizes, bench.sizes, MAX_BENCH_POINTS);
+            for (int k = 0; k < bench.num_sizes; k++) {
+                if (bench.sizes[k] > n) {
+                    n = bench.sizes[k];
+                }
+            }
+        }
+        if (bench.num_threads < 1 || bench.num_sizes < 0) {
+            printf("Error: invalid --bench-threads or --bench-sizes list\n");
+            return 1;
+        }
+        for (int k = 0; k < bench.num_threads; k++) {
+            if (bench.threads[k] > num_threads) {
+                num_threads = (int)bench.threads[k];
+            }
+        }
+        if (num_threads > MAX_THREADS) {
+            printf("Error: thread count must be between 1 and %d\n", MAX_THREADS);
+            return 1;
+        }
+        bench.chunk_size = chunk_size;
     }
     
-    // Record end time for multithreaded processing
-    clock_t mt_end_time = clock();
-    double mt_processing_time = (double)(mt_end_time - mt_start_time) / CLOCKS_PER_SEC;
-    
-    // Print the multithreaded result
-    printf("\n===== Multithreaded Processing Results =====\n");
-    printf("Number of sensor readings (n): %d\n", n);
-    printf("Number of threads: %d\n", NUM_THREADS);
-    printf("Total sum of sensor values: %lld\n", total_sum);
-    printf("Multithreaded processing time: %.4f seconds\n", mt_processing_time);
-    
-    // Verify result with a single-threaded calculation
-    printf("\nVerifying with single-threaded processing...\n");
+    // Emitting wire records writes binary data to stdout, so no banner
+    if (emit_count > 0) {
+        return emit_wire_records(emit_count, seed);
+    }
+    // Shard workers report to their coordinator, not the terminal
+    if (shard_worker != NULL) {
+        return run_shard_worker(shard_worker, num_threads, chunk_size);
+    }
     
-    // Record start time for single-threaded processing
-    clock_t st_start_time = clock();
+    printf("===== Agricultural Sensor Data Processing System =====\n");
+    printf("This system demonstrates multithreaded processing of large sensor datasets\n");
+    printf("for agricultural technology applications.\n\n");
     
-    long long verification_sum = 0;
-    for (int i = 0; i < n; i++) {
-        verification_sum += sensor_readings[i].value;
+    if (live_source != NULL) {
+        if (num_aggregators < 1 || num_aggregators > NUM_SECTORS || publish_ms < 1 || report_ms < 1) {
+            printf("Error: --aggregators must be 1-%d and intervals positive\n", NUM_SECTORS);
+            return 1;
+        }
+        return run_live(live_source, num_aggregators, publish_ms, report_ms);
+    }
+    if (coordinator_path != NULL) {
+        return run_coordinator(argv[0], coordinator_path, num_workers, num_shards, socket_path,
+                               num_threads, chunk_size, kernel_request, verify_checksum, shard_timeout);
     }
     
-    // Record end time for single-threaded processing
-    clock_t st_end_time = clock();
-    double st_processing_time = (double)(st_end_time - st_start_time) / CLOCKS_PER_SEC;
-    
-    printf("Single-threaded sum: %lld\n", verification_sum);
-    printf("Single-threaded processing time: %.4f seconds\n", st_processing_time);
+    // Create the worker pool once; every job below reuses it
+    ThreadPool *pool = pool_create(num_threads);
+    if (pool == NULL) {
+        printf("Failed to create thread pool\n");
+        return 1;
+    }
+    if (pin_threads && pool_pin_workers(pool) != 0) {
+        pool_destroy(pool);
+        return 1;
+    }
+    if (numa_mode) {
+        // Static deal: generation first-touches each worker's pages on its
+        // own node, and every later pass reads them from the same worker
+        pool->stealing = 0;
+        bench.numa = 1;
+        bench.generated_threads = num_threads;
+    }
+    if (perf_mode && (perf_session = perf_open(pool)) == NULL) {
+        printf("Memory allocation failed\n");
+        pool_destroy(pool);
+        return 1;
+    }
+    if (self_check_count > 0) {
+        int status = run_self_check(pool, num_threads, chunk_size, self_check_count);
+        pool_destroy(pool);
+        return status;
+    }
     
-    // Calculate speedup
-    double speedup = st_processing_time / mt_processing_time;
+    if (!bench_mode && where == NULL) {
+        rolling_stats = rolling_create();
+        if (sketch_request != NULL) {
+            sketch = sketch_create(strcmp(sketch_request, "kll") == 0 ? SKETCH_KLL : SKETCH_HISTOGRAM);
+        }
+        if (rolling_stats == NULL || (sketch_request != NULL && sketch == NULL)) {
+            printf("Memory allocation failed\n");
+            free(rolling_stats);
+            sketch_free(sketch);
+            pool_destroy(pool);
+            return 1;
+        }
+    }
     
-    if (total_sum == verification_sum) {
-        printf("\nVerification successful: Multithreaded and single-threaded sums match.\n");
-        printf("Performance speedup: %.2fx faster with multithreading\n", speedup);
+    int status = 0;
+    if (stream_path != NULL) {
+        // Out-of-core: constant memory however large the file is
+        status = process_stream(pool, num_threads, chunk_size, stream_path,
+                                batch_size > 0 ? batch_size : DEFAULT_STREAM_BATCH, verify_checksum, sketch);
+    } else if (ingest_source != NULL) {
+        // Many files: reads of the next batches overlap aggregation of this one
+        status = process_ingest(pool, num_threads, chunk_size, ingest_source,
+                                batch_size > 0 ? batch_size : DEFAULT_INGEST_BATCH, io_depth,
+                                strcmp(io_backend, "uring") == 0, verify_checksum, sketch);
+    } else if (archive_path != NULL) {
+        // Compressed: blocks are decoded into per-worker buffers as they are aggregated
+        status = process_archive(pool, num_threads, chunk_size, archive_path, verify_checksum, sketch, rolling_stats);
     } else {
-        printf("\nVerification failed: Sums do not match!\n");
+        if (input_path != NULL) {
+            // Map an existing dataset; the readings are aggregated where they lie
+            printf("Mapping sensor dataset '%s'...\n", input_path);
+            if (map_dataset(input_path, &sensor_data, verify_checksum) != 0) {
+                pool_destroy(pool);
+                return 1;
+            }
+            prefetch_readings(&sensor_data, 0, sensor_data.count);
+            n = sensor_data.count;
+        } else {
+            // Get the value of n from the user if it was not given on the command line
+            if (n == 0) {
+                printf("Enter the number of sensor readings to process (n > %d): ", MIN_ARRAY_SIZE);
+                if (scanf("%lld", &n) != 1) {
+                    n = 0;
+                }
+            }
+            
+            // Validate input
+            if (n <= MIN_ARRAY_SIZE) {
+                printf("Error: n must be greater than %d\n", MIN_ARRAY_SIZE);
+                pool_destroy(pool);
+                return 1;
+            }
+            
+            // Allocate memory for the sensor reading columns
+            if (allocate_columns(&sensor_data, n) != 0) {
+                printf("Memory allocation failed\n");
+                pool_destroy(pool);
+                return 1;
+            }
+            
+            // Generate simulated sensor data
+            if (perf_session != NULL) {
+                perf_phase_begin(perf_session);
+            }
+            generate_sensor_data(pool, num_threads, chunk_size, seed, span);
+            if (perf_session != NULL) {
+                perf_phase_end(perf_session, "generate", num_threads, sizeof(SensorReading));
+            }
+            if (page_mode != PAGES_DEFAULT && !bench_mode) {
+                print_page_backing("Reading buffers", &sensor_data);
+            }
+            
+            if (output_path != NULL) {
+                printf("Saving sensor dataset to '%s'...\n", output_path);
+                if (write_dataset(output_path, &sensor_data) != 0) {
+                    free_columns(&sensor_data);
+                    pool_destroy(pool);
+                    return 1;
+                }
+            }
+        }
+        
+        if (archive_output != NULL) {
+            printf("Compressing sensor data into archive '%s'...\n", archive_output);
+            if (write_archive(pool, num_threads, chunk_size, &sensor_data, archive_output) != 0) {
+                free_columns(&sensor_data);
+                pool_destroy(pool);
+                return 1;
+            }
+        }
+        
+        if (bench_mode) {
+            // Without --bench-sizes, benchmark the whole loaded dataset
+            for (int k = 0; k < bench.num_sizes; k++) {
+                if (bench.sizes[k] > n) {
+                    bench.sizes[k] = n;
+                }
+            }
+            if (bench.num_sizes == 0) {
+                bench.sizes[bench.num_sizes++] = n;
+            }
+            status = run_benchmark(pool, &bench);
+        } else if (where != NULL) {
+            status = run_query(pool, num_threads, chunk_size, &sensor_query, where);
+        } else {
+            status = process_in_memory(pool, num_threads, chunk_size, sketch);
+            
+            if (numa_mode) {
+                print_numa_report(pool, num_threads, chunk_size);
+            }
+        }
+        
+        if (show_scaling) {
+            print_scaling_curve(pool, chunk_size);
+        }
     }
     
-    // Perform additional agricultural data analysis
-    analyze_sensor_data_by_type();
-    analyze_sensor_data_by_sector();
+    if (sketch != NULL && sketch->failed) {
+        status = 1;
+    }
+    if (rolling_stats != NULL && rolling_stats->newest_bucket >= 0) {
+        print_rolling_report(rolling_stats, rolling_window, query_sector, query_type);
+    } else if (rolling_stats != NULL && status == 0) {
+        printf("\nDataset has no timestamps (schema version 1); rolling statistics skipped\n");
+    }
     
-    // Print agricultural technology application insights
-    printf("\n===== Agricultural Technology Insights =====\n");
-    printf("This multithreaded processing system demonstrates how parallel computing\n");
-    printf("can accelerate agricultural data analysis for time-sensitive decisions.\n");
-    printf("Applications include:\n");
-    printf("1. Real-time irrigation management based on soil moisture sensors\n");
-    printf("2. Climate control in greenhouses using temperature and humidity data\n");
-    printf("3. Precision agriculture with field-sector specific interventions\n");
-    printf("4. Crop health monitoring through nutrient level analysis\n");
-    printf("5. Optimized harvesting schedules based on environmental conditions\n");
+    // Print agricultural technology application insights (not part of benchmark output)
+    if (!bench_mode) {
+        printf("\n===== Agricultural Technology Insights =====\n");
+        printf("This multithreaded processing system demonstrates how parallel computing\n");
+        printf("can accelerate agricultural data analysis for time-sensitive decisions.\n");
+        printf("Applications include:\n");
+        printf("1. Real-time irrigation management based on soil moisture sensors\n");
+        printf("2. Climate control in greenhouses using temperature and humidity data\n");
+        printf("3. Precision agriculture with field-sector specific interventions\n");
+        printf("4. Crop health monitoring through nutrient level analysis\n");
+        printf("5. Optimized harvesting schedules based on environmental conditions\n");
+    }
     
     // Clean up
-    free(sensor_readings);
-    pthread_mutex_destroy(&mutex);
+    perf_close(perf_session);
+    pool_destroy(pool);
+    free_columns(&sensor_data);
+    free(rolling_stats);
+    sketch_free(sketch);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        sketch_free(thread_data[i].sketch);
+        free(thread_data[i].rolling);
+    }
     
-    return 0;
+    return status;
 }
@@ -0,0 +1,126 @@
+#!/bin/bash
+# Agricultural Sensor Data Processing System
+# Regression checks for multithreaded_sum: builds the program, runs its
+# known-answer self-check on reading counts past INT_MAX, where any 32-bit
+# count, sum or index in the pipeline gives a wrong answer, and compares
+# the other modes with an in-memory run on the same generated readings.
+#
+# Usage: ./test_multithreaded_sum.sh [READINGS]
+#   READINGS  readings for the large checks (default 2300000000, past 2^31);
+#             they are mapped sparsely, so this needs little memory
+
+cd "$(dirname "$0")" || exit 1
+
+READINGS=${1:-2300000000}
+
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+PROGRAM="$WORK/multithreaded_sum"
+
+echo "Compiling multithreaded_sum..."
+if ! gcc -O2 -Wall -Wextra -o "$PROGRAM" multithreaded_sum.c -lpthread -lm; then
+    echo "Compilation failed."
+    exit 1
+fi
+
+FAILURES=0
+
+# Function to report one check: check NAME COMMAND...
+check() {
+    local name=$1
+    shift
+    if "$@" > "$WORK/output"; then
+        echo "PASS  $name"
+    else
+        echo "FAIL  $name"
+        grep -E 'FAIL|Error' "$WORK/output"
+        FAILURES=$((FAILURES + 1))
+    fi
+}
+
+check "small self-check with uneven chunks" "$PROGRAM" --self-check 10000019 --threads 3 --chunk 1000
+check "$READINGS readings, best kernels" "$PROGRAM" --self-check "$READINGS" --threads 4
+check "$READINGS readings, scalar kernels" "$PROGRAM" --self-check "$READINGS" --threads 2 --kernel scalar
+
+# Function to keep the totals a run reports: overall, per type and per sector
+totals_of() {
+    grep -E '^Total sum of sensor values|readings, Sum:' "$1"
+}
+
+# The reference: generated readings aggregated in memory, and saved as a
+# dataset file and as an archive
+DATASET="$WORK/readings.bin"
+ARCHIVE="$WORK/readings.arc"
+"$PROGRAM" -n 4000000 --seed 7 --threads 2 -o "$DATASET" --write-archive "$ARCHIVE" > "$WORK/memory"
+totals_of "$WORK/memory" > "$WORK/reference"
+mkdir "$WORK/ingest" && ln -s "$DATASET" "$WORK/ingest/readings.bin"
+
+# Function to run one mode on the saved readings and compare its totals
+# with the reference: matches_reference NAME ARGS...
+matches_reference() {
+    local name=$1
+    shift
+    "$PROGRAM" --threads 2 "$@" > "$WORK/$name" &&
+        totals_of "$WORK/$name" | cmp -s "$WORK/reference" -
+}
+check "dataset file round-trip (--input)" matches_reference input -i "$DATASET"
+check "streamed in uneven batches (--stream)" matches_reference stream -s "$DATASET" --batch 1000003
+check "compressed archive (--archive)" matches_reference archive -a "$ARCHIVE"
+check "ingested with io_uring" matches_reference uring --ingest "$WORK/ingest" --io uring
+check "ingested with pread" matches_reference pread --ingest "$WORK/ingest" --io pread
+
+# Function to print "group count sum" for each row of a query's table, or
+# each per-type and per-sector line of a report
+group_sums_of() {
+    sed -nE -e 's/^(.+): ([0-9]+) readings, Sum: (-?[0-9]+),.*/\1 \2 \3/p' \
+        -e '/^===== Query/,/^$/ s/^([A-Za-z]+( [A-Za-z0-9]+)*) +([0-9]+) +(-?[0-9]+) .*/\1 \3 \4/p' "$1"
+}
+
+# Function to check the indexed query paths: a selective query must agree
+# with the program's own full scan, and an all-matching one grouped by type
+# and by sector must give the reference totals
+indexed_queries_match() {
+    "$PROGRAM" --threads 2 -i "$DATASET" --where 'type=light|soil,sector=3-9,value>800' \
+        --group-by sector > "$WORK/where" &&
+        grep -q '^Verification successful' "$WORK/where" &&
+        "$PROGRAM" --threads 2 -i "$DATASET" --where 'value>=0' --group-by type > "$WORK/by-type" &&
+        "$PROGRAM" --threads 2 -i "$DATASET" --where 'value>=0' --group-by sector > "$WORK/by-sector" &&
+        cat "$WORK/by-type" "$WORK/by-sector" > "$WORK/by-group" &&
+        group_sums_of "$WORK/by-group" | cmp -s <(group_sums_of "$WORK/memory") -
+}
+check "--where/--group-by against the full scan and the reference" indexed_queries_match
+
+# Function to SIGKILL both workers of a coordinator once each holds a shard
+# (it has mapped the dataset) and compare the totals with the reference.
+# The coordinator must deal their shards again and start replacements.
+coordinator_survives_killed_workers() {
+    "$PROGRAM" --coordinator "$DATASET" --workers 2 --shards 20000 > "$WORK/coordinator" &
+    local coordinator=$! workers="" busy=0 waited=0
+    while [ "$busy" -lt 2 ] && [ "$waited" -lt 2000 ] && kill -0 "$coordinator" 2> /dev/null; do
+        workers=$(pgrep -P "$coordinator")
+        busy=0
+        for worker in $workers; do
+            grep -q "$DATASET" "/proc/$worker/maps" 2> /dev/null && busy=$((busy + 1))
+        done
+        waited=$((waited + 1))
+    done
+    kill -KILL $workers 2> /dev/null
+
+    # A coordinator that lost track of its workers would never exit
+    for ((waited = 0; waited < 600; waited++)); do
+        kill -0 "$coordinator" 2> /dev/null || break
+        sleep 0.1
+    done
+    if kill -0 "$coordinator" 2> /dev/null; then
+        echo "Error: the coordinator still runs 60 s after its workers were killed"
+        kill -KILL "$coordinator" $(pgrep -P "$coordinator")
+        return 1
+    fi
+    wait "$coordinator" &&
+        grep -q '^Lost worker' "$WORK/coordinator" &&
+        totals_of "$WORK/coordinator" | cmp -s "$WORK/reference" -
+}
+check "coordinator with its workers killed mid-run" coordinator_survives_killed_workers
+
+echo "$FAILURES check(s) failed."
+[ "$FAILURES" -eq 0 ]